@@ -0,0 +1,147 @@
+// Throughput of the CPU mesh generators in mesh_generators.h, without a GL context. Each generator runs for at
+// least minSeconds per parameter set; the frame arena is rewound after every call, as the app does every frame.
+
+#include <mesh_generators.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+constexpr double minSeconds = 0.25;
+
+// keeps the results alive so that the generators are not optimized away
+volatile float sink;
+
+// mean seconds per call of f
+template <typename F>
+double time_per_call(F&& f) {
+    using clock = std::chrono::steady_clock;
+
+    size_t calls = 0;
+    double elapsed = 0.0;
+    const auto start = clock::now();
+    do {
+        f();
+        frame_arena.reset();
+        ++calls;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < minSeconds);
+
+    return elapsed / static_cast<double>(calls);
+}
+
+void report(const char* generator, const char* parameters, size_t vertices, size_t edges, double seconds) {
+    std::printf(
+        "%-10s %-22s %10zu %10zu %12.3f %14.1f\n",
+        generator, parameters, vertices, edges, seconds * 1e6, static_cast<double>(vertices) / seconds * 1e-6
+    );
+}
+
+void bench_torus() {
+    for (unsigned int samples : {8u, 32u, 128u, 512u, 1000u}) {
+        size_t vertices = 0;
+        size_t edges = 0;
+        const double seconds = time_per_call([&] {
+            auto v = torus_vertices(1.0f, 0.25f, samples, samples);
+            vertices = v.size();
+            if (fitsShortIndices(v.size())) {
+                edges = torus_edges<Edge>(samples, samples).size();
+            } else {
+                edges = torus_edges<Edge32>(samples, samples).size();
+            }
+            sink = v.back().x;
+        });
+
+        char parameters[32];
+        std::snprintf(parameters, sizeof(parameters), "%u x %u samples", samples, samples);
+        report("torus", parameters, vertices, edges, seconds);
+    }
+}
+
+void bench_sphere() {
+    for (unsigned int samples : {3u, 5u, 10u, 20u, 64u}) {
+        size_t vertices = 0;
+        size_t edges = 0;
+        const double seconds = time_per_call([&] {
+            auto v = sphere_vertices(0.01f, samples);
+            vertices = v.size();
+            edges = sphere_edges<Edge>(samples).size();
+            sink = v.back().x;
+        });
+
+        char parameters[32];
+        std::snprintf(parameters, sizeof(parameters), "%u samples", samples);
+        report("sphere", parameters, vertices, edges, seconds);
+    }
+}
+
+void bench_polyline() {
+    for (size_t points : {size_t{16}, size_t{1} << 12, size_t{1} << 16, size_t{1} << 20}) {
+        size_t edges = 0;
+        const double seconds = time_per_call([&] {
+            if (fitsShortIndices(points)) {
+                edges = polyline_edges<Edge>(points).size();
+            } else {
+                edges = polyline_edges<Edge32>(points).size();
+            }
+        });
+
+        char parameters[32];
+        std::snprintf(parameters, sizeof(parameters), "%zu points", points);
+        report("polyline", parameters, points, edges, seconds);
+    }
+}
+
+// random segments inside a unit cube seen from a 1080p camera; vertices counts what the subdivision emitted
+void bench_bezier() {
+    constexpr unsigned int width = 1920;
+    constexpr unsigned int height = 1080;
+    constexpr size_t segmentCount = 1024;
+
+    const mat4 view = lookAt(vec3(0.0f, 0.0f, 3.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const mat4 projection = perspective(radians(45.0f), static_cast<float>(width) / height, 0.1f, 100.0f);
+    const mat4 projection_view = view * projection;
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+    std::vector<vec3> control_points(3 * segmentCount + 1);
+    for (vec3& p : control_points) {
+        p = vec3(coordinate(random), coordinate(random), coordinate(random));
+    }
+
+    std::vector<vec3> out((1u << maxSubdivisionDepth) + 1);
+
+    for (float tolerance : {2.0f, 0.5f, 0.1f}) {
+        size_t vertices = 0;
+        const double seconds = time_per_call([&] {
+            vertices = 0;
+            for (size_t i = 0; i < segmentCount; ++i) {
+                const vec3* p = &control_points[3 * i];
+
+                vec3 screen[4];
+                for (unsigned int k = 0; k < 4; ++k) {
+                    screen[k] = to_screen(projection_view, p[k], width, height);
+                }
+                const unsigned int depth = calc_subdivision_depth(calc_segment_density(screen, tolerance));
+                vertices += calc_segment_vertices(projection_view, width, height, p, tolerance, depth, out.data());
+            }
+            sink = out[0].x;
+        });
+
+        char parameters[32];
+        std::snprintf(parameters, sizeof(parameters), "%zu segments, %.1f px", segmentCount, tolerance);
+        report("bezier", parameters, vertices, vertices - segmentCount, seconds);
+    }
+}
+
+int main() {
+    std::printf(
+        "%-10s %-22s %10s %10s %12s %14s\n", "generator", "parameters", "vertices", "edges", "us/call", "Mvertices/s"
+    );
+
+    bench_torus();
+    bench_sphere();
+    bench_polyline();
+    bench_bezier();
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Load throughput of the scene formats without a GL context: a generated scene of about the requested size
+// (100 MB of JSON by default, "scene_bench <megabytes>" for another size) is written to the temporary directory
+// as JSON and as a binary scene file, then loaded the way load_scene_json and load_scene_file do up to
+// build_scene. The files were just written, so the page cache is warm and the disk is not measured.
+
+#include <scene_format.h>
+#include <scene_json_reader.h>
+#include <utility/mapped_file.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+constexpr double minSeconds = 1.0;
+
+// every pointsPerTorus-th point brings a torus, every pointsPerCurve points form a curve
+constexpr size_t pointsPerTorus = 100;
+constexpr size_t pointsPerCurve = 4;
+
+// mean seconds per call of f
+template <typename F>
+double time_per_call(F&& f) {
+    using clock = std::chrono::steady_clock;
+
+    size_t calls = 0;
+    double elapsed = 0.0;
+    const auto start = clock::now();
+    do {
+        if (!f()) {
+            std::fprintf(stderr, "load failed\n");
+            std::exit(1);
+        }
+        ++calls;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < minSeconds);
+
+    return elapsed / static_cast<double>(calls);
+}
+
+void report(const char* stage, size_t bytes, size_t objects, double seconds) {
+    const double megabytes = static_cast<double>(bytes) * 1e-6;
+    std::printf(
+        "%-14s %10.1f %12.1f %10.1f %14.2f\n",
+        stage, megabytes, seconds * 1e3, megabytes / seconds, static_cast<double>(objects) / seconds * 1e-6
+    );
+}
+
+// a point is about 115 bytes of JSON with its share of the tori and curves
+size_t write_json(const char* path, size_t target_bytes) {
+    std::ofstream out(path, std::ios::trunc);
+    JsonWriter json(out);
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+
+    const size_t points = target_bytes / 115;
+    json.begin_object();
+
+    json.key("points").begin_array();
+    for (size_t i = 0; i < points; ++i) {
+        json.begin_object().field("id", i).field("name", "point");
+        json.key("position").begin_object()
+            .field("x", coordinate(random))
+            .field("y", coordinate(random))
+            .field("z", coordinate(random))
+            .end_object();
+        json.end_object();
+    }
+    json.end_array();
+
+    size_t id = points;
+    json.key("geometry").begin_array();
+    for (size_t i = 0; i < points / pointsPerTorus; ++i) {
+        json.begin_object().field("objectType", "torus").field("id", id++).field("name", "torus");
+        json.key("position").begin_object().field("x", coordinate(random)).field("y", 0.0f).field("z", 0.0f)
+            .end_object();
+        json.key("rotation").begin_object().field("x", 0.0f).field("y", 0.0f).field("z", 0.0f).field("w", 1.0f)
+            .end_object();
+        json.key("scale").begin_object().field("x", 1.0f).field("y", 1.0f).field("z", 1.0f).end_object();
+        json.key("samples").begin_object().field("x", 32).field("y", 16).end_object();
+        json.field("smallRadius", 0.25f).field("largeRadius", 1.0f);
+        json.end_object();
+    }
+    for (size_t first = 0; first + pointsPerCurve <= points; first += pointsPerCurve) {
+        json.begin_object().field("objectType", "bezierC0").field("id", id++).field("name", "curve");
+        json.key("controlPoints").begin_array();
+        for (size_t i = first; i < first + pointsPerCurve; ++i) {
+            json.begin_object().field("id", i).end_object();
+        }
+        json.end_array();
+        json.end_object();
+    }
+    json.end_array();
+
+    json.end_object();
+    json.flush();
+    return id;
+}
+
+int main(int argc, char** argv) {
+    const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string json_path = (directory / "scene_bench.json").string();
+    const std::string binary_path = (directory / "scene_bench.mg1").string();
+
+    const size_t objects = write_json(json_path.c_str(), megabytes * 1000000);
+
+    MappedFile file;
+    if (!file.open(json_path.c_str())) {
+        std::fprintf(stderr, "Failed to write %s\n", json_path.c_str());
+        return 1;
+    }
+    const std::string_view text(reinterpret_cast<const char*>(file.data), file.size);
+
+    // the binary file holds the arrays the JSON reader produces
+    SceneJsonReader converter(text);
+    if (!converter.read() || !write_scene_file(binary_path.c_str(), converter.arrays)) {
+        return 1;
+    }
+    const size_t binary_bytes = std::filesystem::file_size(binary_path);
+
+    std::printf("%-14s %10s %12s %10s %14s\n", "stage", "MB", "ms/load", "MB/s", "Mobjects/s");
+
+    // the tokenizer alone, the floor for any JSON load
+    const double tokens = time_per_call([&] {
+        JsonReader json(text);
+        JsonReader::Token token;
+        do {
+            token = json.next();
+        } while (token != JsonReader::Token::End && token != JsonReader::Token::Error);
+        return token == JsonReader::Token::End;
+    });
+    report("json tokens", text.size(), objects, tokens);
+
+    // load_scene_json without build_scene
+    const double json_load = time_per_call([&] {
+        MappedFile mapped;
+        if (!mapped.open(json_path.c_str())) {
+            return false;
+        }
+        SceneJsonReader reader({reinterpret_cast<const char*>(mapped.data), mapped.size});
+        return reader.read() && reader.arrays.view().validate();
+    });
+    report("json load", text.size(), objects, json_load);
+
+    // load_scene_file without build_scene
+    const double binary_load = time_per_call([&] {
+        MappedFile mapped;
+        SceneFileView view;
+        return mapped.open(binary_path.c_str()) && view.parse(mapped.data, mapped.size);
+    });
+    report("binary load", binary_bytes, objects, binary_load);
+
+    file.close();
+    std::filesystem::remove(json_path);
+    std::filesystem::remove(binary_path);
+    return 0;
+}
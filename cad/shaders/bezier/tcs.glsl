@@ -0,0 +1,46 @@
+#version 460 core
+layout (vertices = 4) out;
+
+layout (std140, binding = 0) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
+uniform mat4 model;
+uniform vec2 u_viewport;
+uniform float u_pixels_per_segment;
+
+const float max_tess_level = 64.0;
+
+vec2 to_screen(vec4 clip) {
+    return (clip.xy / clip.w * 0.5 + 0.5) * u_viewport;
+}
+
+void main()
+{
+    gl_out[gl_InvocationID].gl_Position = gl_in[gl_InvocationID].gl_Position;
+
+    if (gl_InvocationID == 0) {
+        mat4 mvp = projection * view * model;
+        vec4 c0 = mvp * gl_in[0].gl_Position;
+        vec4 c1 = mvp * gl_in[1].gl_Position;
+        vec4 c2 = mvp * gl_in[2].gl_Position;
+        vec4 c3 = mvp * gl_in[3].gl_Position;
+
+        float level = max_tess_level;
+
+        // a control point behind the camera has no meaningful screen position, keep full detail
+        if (min(min(c0.w, c1.w), min(c2.w, c3.w)) > 1e-4) {
+            vec2 s0 = to_screen(c0);
+            vec2 s1 = to_screen(c1);
+            vec2 s2 = to_screen(c2);
+            vec2 s3 = to_screen(c3);
+
+            // the control polygon length bounds the length of the curve
+            float polygon_length = distance(s0, s1) + distance(s1, s2) + distance(s2, s3);
+            level = clamp(polygon_length / u_pixels_per_segment, 1.0, max_tess_level);
+        }
+
+        gl_TessLevelOuter[0] = 1.0;
+        gl_TessLevelOuter[1] = level;
+    }
+}
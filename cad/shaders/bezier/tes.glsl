@@ -0,0 +1,30 @@
+#version 460 core
+layout (isolines, equal_spacing) in;
+
+layout (std140, binding = 0) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
+uniform mat4 model;
+uniform bool u_selected;
+
+out vec3 color;
+
+void main()
+{
+    float t = gl_TessCoord.x;
+    float mt = 1.0 - t;
+
+    vec4 position = gl_in[0].gl_Position * (mt * mt * mt) +
+                    gl_in[1].gl_Position * (3.0 * t * mt * mt) +
+                    gl_in[2].gl_Position * (3.0 * t * t * mt) +
+                    gl_in[3].gl_Position * (t * t * t);
+
+    gl_Position = projection * view * model * position;
+
+    if (u_selected) {
+        color = vec3(1.0f, 0.8f, 0.3f);
+    } else {
+        color = vec3(0.8f, 0.6f, 0.2f);
+    }
+}
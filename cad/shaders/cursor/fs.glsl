@@ -1,8 +1,11 @@
 #version 460 core
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out uint FragObjectId;
 in vec3 color;
+uniform uint u_object_id;
 
 void main()
 {
     FragColor = vec4(color, 1.0);
+    FragObjectId = u_object_id;
 }
@@ -2,8 +2,10 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140, binding = 0) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
 uniform mat4 model;
 uniform bool u_selected;
 
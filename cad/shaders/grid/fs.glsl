@@ -1,27 +1,63 @@
 #version 460 core
 
-in vec3 worldPos;
-out vec4 FragColor;
+layout (std140, binding = 0) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
+
+in vec3 nearPoint;
+in vec3 farPoint;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out uint FragObjectId;
+
+const vec3 grid_lines_color = vec3(0.5, 0.5, 0.5);
+const vec3 z_axis_color = vec3(0.0, 0.0, 1.0);
+const vec3 x_axis_color = vec3(1.0, 0.0, 0.0);
+
+// coverage of lines every cell_size units, about one pixel wide whatever the distance
+float grid_coverage(vec2 coord, float cell_size) {
+    vec2 cell = coord / cell_size;
+    vec2 derivative = fwidth(cell);
+    vec2 distance_to_line = abs(fract(cell - 0.5) - 0.5) / derivative;
+    float coverage = 1.0 - min(min(distance_to_line.x, distance_to_line.y), 1.0);
+
+    // lines closer than a few pixels apart fade out, so the density on screen stays bounded
+    float density = max(derivative.x, derivative.y);
+    return coverage * (1.0 - smoothstep(0.1, 0.3, density));
+}
 
 void main() {
-    float lineWidth = 0.01;
-
-    vec4 background_color = vec4(0.1, 0.1, 0.1, 1.0);
-    vec4 grid_lines_color = vec4(0.5, 0.5, 0.5, 1.0);
-    vec4 z_axis_color = vec4(0.0, 0.0, 1.0, 1.0);
-    vec4 x_axis_color = vec4(1.0, 0.0, 0.0, 1.0);
-
-    if (abs(worldPos.y) < 1e-5f) {
-        if (abs(worldPos.x) < 1e-5f) {
-            FragColor = z_axis_color;
-        } else if (abs(worldPos.z) < 1e-5f) {
-            FragColor = x_axis_color;
-        } else if (abs(worldPos.x - round(worldPos.x)) < lineWidth || abs(worldPos.z - round(worldPos.z)) < lineWidth) {
-            FragColor =  grid_lines_color;
-        } else {
-            FragColor = background_color;
-        }
-    } else {
+    // t runs from the near plane (0) to the far plane (1) along the pixel's ray
+    float t = -nearPoint.y / (farPoint.y - nearPoint.y);
+    if (t <= 0.0 || t > 1.0) {
         discard;
     }
+
+    vec3 worldPos = nearPoint + t * (farPoint - nearPoint);
+    vec4 clip = projection * view * vec4(worldPos, 1.0);
+
+    vec2 coord = worldPos.xz;
+    vec2 derivative = fwidth(coord);
+
+    float alpha = max(grid_coverage(coord, 1.0), grid_coverage(coord, 10.0));
+    vec3 color = grid_lines_color;
+
+    if (abs(worldPos.x) < derivative.x) {
+        color = z_axis_color;
+        alpha = 1.0;
+    } else if (abs(worldPos.z) < derivative.y) {
+        color = x_axis_color;
+        alpha = 1.0;
+    }
+
+    // fade towards the far plane instead of aliasing into noise at grazing angles
+    alpha *= 1.0 - smoothstep(0.2, 1.0, t);
+
+    if (alpha < 0.01) {
+        discard;
+    }
+
+    FragColor = vec4(color, alpha);
+    FragObjectId = 0u;
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
 }
@@ -1,13 +1,26 @@
 #version 460 core
 
-layout (location = 0) in vec3 aPos;
+layout (std140, binding = 0) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
 
-uniform mat4 projection;
-uniform mat4 view;
+// full-screen triangle, the fragment shader intersects each pixel's view ray with the y = 0 plane
+const vec2 corners[3] = vec2[](vec2(-1.0, -1.0), vec2(3.0, -1.0), vec2(-1.0, 3.0));
 
-out vec3 worldPos;
+out vec3 nearPoint;
+out vec3 farPoint;
+
+vec3 unproject(vec2 ndc, float z, mat4 inverse_projection_view) {
+    vec4 p = inverse_projection_view * vec4(ndc, z, 1.0);
+    return p.xyz / p.w;
+}
 
 void main() {
-    worldPos = aPos;
-    gl_Position = projection * view * vec4(aPos, 1.0);
+    mat4 inverse_projection_view = inverse(projection * view);
+    vec2 ndc = corners[gl_VertexID];
+
+    nearPoint = unproject(ndc, -1.0, inverse_projection_view);
+    farPoint = unproject(ndc, 1.0, inverse_projection_view);
+    gl_Position = vec4(ndc, 0.0, 1.0);
 }
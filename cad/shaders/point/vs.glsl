@@ -1,17 +1,36 @@
 #version 460 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140, binding = 0) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
 uniform mat4 model;
 uniform bool u_selected;
 
+// batched mode: one glMultiDrawElementsIndirect for many objects, per-object data is indexed by gl_DrawID
+struct ObjectData {
+    mat4 model;
+    uint flags;
+    uint pick_id;
+};
+layout (std430, binding = 0) readonly buffer Objects {
+    ObjectData objects[];
+};
+uniform bool u_batched;
+uniform uint u_object_id;
+
 out vec3 color;
+flat out uint object_id;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    if (u_selected) {
+    mat4 object_model = u_batched ? objects[gl_DrawID].model : model;
+    bool selected = u_batched ? (objects[gl_DrawID].flags & 1u) != 0u : u_selected;
+    object_id = u_batched ? objects[gl_DrawID].pick_id : u_object_id;
+
+    gl_Position = projection * view * object_model * vec4(aPos, 1.0);
+    if (selected) {
         color = vec3(1.0f, 0.8f, 0.3f);
     } else {
         color = vec3(0.8f, 0.6f, 0.2f);
@@ -1,17 +1,70 @@
 #version 460 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140, binding = 0) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
 uniform mat4 model;
 uniform bool u_selected;
 
+// batched mode: one glMultiDrawElementsIndirect for many objects, per-object data is indexed by gl_DrawID
+struct ObjectData {
+    mat4 model;
+    uint flags;
+    uint pick_id;
+};
+layout (std430, binding = 0) readonly buffer Objects {
+    ObjectData objects[];
+};
+uniform bool u_batched;
+uniform uint u_object_id;
+
+// procedural mode: no vertex buffer, positions are computed from gl_VertexID
+uniform bool u_procedural;
+uniform float u_big_radius;
+uniform float u_small_radius;
+uniform uint u_theta_samples;
+uniform uint u_phi_samples;
+
 out vec3 color;
+flat out uint object_id;
+
+const float PI = 3.14159265359;
+
+// every (theta, phi) grid cell emits its three unique edges: (i, j)-(i, j+1), (i, j+1)-(i+1, j), (i+1, j)-(i, j)
+const uvec2 cell_corners[6] = uvec2[](
+    uvec2(0, 0), uvec2(0, 1),
+    uvec2(0, 1), uvec2(1, 0),
+    uvec2(1, 0), uvec2(0, 0)
+);
+
+vec3 torus_vertex(uint vertex_id) {
+    uint cell = vertex_id / 6u;
+    uvec2 corner = cell_corners[vertex_id % 6u];
+
+    uint i = (cell / u_phi_samples + corner.x) % u_theta_samples;
+    uint j = (cell % u_phi_samples + corner.y) % u_phi_samples;
+
+    float theta = 2.0 * PI * float(i) / float(u_theta_samples);
+    float phi = 2.0 * PI * float(j) / float(u_phi_samples);
+
+    return vec3(
+        (u_big_radius + u_small_radius * cos(phi)) * cos(theta),
+        (u_big_radius + u_small_radius * cos(phi)) * sin(theta),
+        u_small_radius * sin(phi)
+    );
+}
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    if (u_selected) {
+    vec3 position = u_procedural ? torus_vertex(uint(gl_VertexID)) : aPos;
+    mat4 object_model = u_batched ? objects[gl_DrawID].model : model;
+    bool selected = u_batched ? (objects[gl_DrawID].flags & 1u) != 0u : u_selected;
+    object_id = u_batched ? objects[gl_DrawID].pick_id : u_object_id;
+
+    gl_Position = projection * view * object_model * vec4(position, 1.0);
+    if (selected) {
         color = vec3(1.0f, 0.8f, 0.3f);
     } else {
         color = vec3(0.8f, 0.6f, 0.2f);
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <intersection.h>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+// Bounding volume hierarchy over the world bounds of the scene's objects, addressed by their index in the scene.
+// When only bounds change the tree is refit, walking up from the changed leaves; the topology is rebuilt when the
+// number of objects changes.
+struct BVH {
+    static constexpr unsigned int leafSize = 4;
+    static constexpr unsigned int noParent = ~0u;
+
+    struct Node {
+        AABB bounds;
+        unsigned int first = 0; // first index for leaves, left child for inner nodes (right child follows it)
+        unsigned int count = 0; // 0 for inner nodes
+        unsigned int parent = noParent;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> leaf_of; // object index -> leaf node
+    std::vector<AABB> object_bounds;
+    std::vector<bool> dirty;
+
+    void update(const std::vector<AABB>& bounds) {
+        if (bounds.size() != object_bounds.size()) {
+            build(bounds);
+            return;
+        }
+
+        bool changed = false;
+        for (size_t i = 0; i < bounds.size(); ++i) {
+            if (bounds[i] == object_bounds[i]) {
+                continue;
+            }
+            object_bounds[i] = bounds[i];
+            changed = true;
+
+            for (unsigned int node = leaf_of[i]; node != noParent && !dirty[node]; node = nodes[node].parent) {
+                dirty[node] = true;
+            }
+        }
+
+        if (changed) {
+            refit();
+        }
+    }
+
+    void build(const std::vector<AABB>& bounds) {
+        object_bounds = bounds;
+        nodes.clear();
+        indices.resize(bounds.size());
+        std::iota(indices.begin(), indices.end(), 0u);
+        leaf_of.assign(bounds.size(), 0);
+
+        if (!bounds.empty()) {
+            nodes.reserve(2 * bounds.size() / leafSize + 1);
+            nodes.emplace_back();
+            split(0, 0, bounds.size());
+        }
+        dirty.assign(nodes.size(), false);
+    }
+
+    // visits every object whose bounds the ray enters, with the entry distance; inflate widens the boxes by that
+    // many pixels of the ray's spread, so thin objects can be hit within a tolerance
+    template <typename Visit>
+    void query_ray(const Ray& ray, float inflate, Visit&& visit) const {
+        if (nodes.empty()) {
+            return;
+        }
+
+        unsigned int stack[64];
+        unsigned int size = 0;
+        stack[size++] = 0;
+
+        while (size > 0) {
+            const Node& node = nodes[stack[--size]];
+
+            float t_near, t_far;
+            if (!intersect_ray_aabb(ray, inflated(node.bounds, ray, inflate), t_near, t_far)) {
+                continue;
+            }
+
+            if (node.count > 0) {
+                for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+                    visit(indices[i]);
+                }
+            } else if (size + 2 <= std::size(stack)) {
+                stack[size++] = node.first;
+                stack[size++] = node.first + 1;
+            }
+        }
+    }
+
+    template <typename Visit>
+    void query_frustum(const Frustum& frustum, Visit&& visit) const {
+        if (nodes.empty()) {
+            return;
+        }
+
+        unsigned int stack[64];
+        unsigned int size = 0;
+        stack[size++] = 0;
+
+        while (size > 0) {
+            const Node& node = nodes[stack[--size]];
+
+            if (!frustum.intersects(node.bounds)) {
+                continue;
+            }
+
+            if (node.count > 0) {
+                for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+                    visit(indices[i]);
+                }
+            } else if (size + 2 <= std::size(stack)) {
+                stack[size++] = node.first;
+                stack[size++] = node.first + 1;
+            }
+        }
+    }
+
+private:
+    // children are always stored after their parent, so a reverse sweep sees children first
+    void refit() {
+        for (size_t n = nodes.size(); n-- > 0;) {
+            if (!dirty[n]) {
+                continue;
+            }
+            dirty[n] = false;
+
+            Node& node = nodes[n];
+            node.bounds = AABB{};
+            if (node.count > 0) {
+                for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+                    node.bounds.expand(object_bounds[indices[i]]);
+                }
+            } else {
+                node.bounds.expand(nodes[node.first].bounds);
+                node.bounds.expand(nodes[node.first + 1].bounds);
+            }
+        }
+    }
+
+    // median split along the longest axis of the centroids
+    void split(unsigned int n, size_t begin, size_t end) {
+        AABB bounds;
+        AABB centroids;
+        for (size_t i = begin; i < end; ++i) {
+            bounds.expand(object_bounds[indices[i]]);
+            if (!object_bounds[indices[i]].empty()) {
+                centroids.expand(object_bounds[indices[i]].center());
+            }
+        }
+        nodes[n].bounds = bounds;
+
+        if (end - begin <= leafSize || centroids.empty()) {
+            nodes[n].first = begin;
+            nodes[n].count = end - begin;
+            for (size_t i = begin; i < end; ++i) {
+                leaf_of[indices[i]] = n;
+            }
+            return;
+        }
+
+        vec3 extent = centroids.max - centroids.min;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+        auto key = [&](unsigned int index) {
+            const AABB& box = object_bounds[index];
+            if (box.empty()) {
+                return 0.0f;
+            }
+            vec3 c = box.center();
+            return axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+        };
+
+        size_t middle = (begin + end) / 2;
+        std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end,
+                         [&](unsigned int a, unsigned int b) { return key(a) < key(b); });
+
+        unsigned int left = nodes.size();
+        nodes.emplace_back();
+        nodes.emplace_back();
+        nodes[left].parent = n;
+        nodes[left + 1].parent = n;
+        nodes[n].first = left;
+        nodes[n].count = 0;
+
+        split(left, begin, middle);
+        split(left + 1, middle, end);
+    }
+
+    static AABB inflated(const AABB& box, const Ray& ray, float pixels) {
+        if (pixels <= 0.0f || box.empty()) {
+            return box;
+        }
+        vec3 half = (box.max - box.min) * 0.5f;
+        float margin = ray.tolerance(length(box.center() - ray.origin) + length(half), pixels);
+        vec3 m(margin, margin, margin);
+        return AABB{box.min - m, box.max + m};
+    }
+};
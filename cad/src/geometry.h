@@ -1,34 +1,24 @@
 #pragma once
 
 #include <myglm.h>
+#include <intersection.h>
+#include <mesh_generators.h>
+#include "utility/frame_arena.h"
+#include "utility/gl_state.h"
+#include "utility/mesh_arena.h"
+#include "utility/mesh_builder.h"
+#include "utility/pool.h"
+#include "utility/shader_manager.h"
+#include "utility/stream_buffer.h"
+#include <algorithm>
 #include <array>
-#include <unordered_set>
+#include <bit>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <span>
 #include <vector>
 
-using namespace myglm;
-
-using Vertex = vec3;
-using Triangle = u16vec3;
-using Edge = u16vec2;
-
-constexpr int gridSize = 1000;
-constexpr int gridVertexCount = (2 * gridSize + 1) * 4;
-
-static constexpr std::array<Vertex, gridVertexCount> generateGridVertices(int gridSize) {
-    std::array<Vertex, gridVertexCount> vertices{};
-    int index = 0;
-
-    for (int i = -gridSize; i <= gridSize; ++i) {
-        vertices[index++] = vec3(i, 0, -gridSize);
-        vertices[index++] = vec3(i, 0, gridSize);
-        vertices[index++] = vec3(-gridSize, 0, i);
-        vertices[index++] = vec3(gridSize, 0, i);
-    }
-    return vertices;
-}
-
-
-
 struct Transform {
     vec3 rotation;
     vec3 translation;
@@ -86,42 +76,237 @@ struct Transform {
     }
 };
 
+enum class ObjectKind : uint8_t {
+    Cursor,
+    Torus,
+    Point,
+    PolyLine,
+    Bezier,
+    PointCloud
+};
+
 struct Object {
+    // 0 is written where no object covers a pixel of the id attachment
+    static inline unsigned int next_pick_id = 1;
+
     std::string name;
     Transform transform;
-    unsigned int VAO, VBO, EBO;
-    unsigned int shader;
-    unsigned int num_edges;
-    unsigned int uid;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    unsigned int shader = 0;
+    unsigned int num_edges = 0;
+    unsigned int index_type = GL_UNSIGNED_SHORT;
+    ObjectKind kind = ObjectKind::Cursor;
+    // stable for the object's lifetime, unlike its index in the scene
+    unsigned int pick_id = next_pick_id++;
+    // static meshes live in mesh_arena instead of owning a VBO/EBO, which lets the render queue batch them
+    bool in_arena = false;
+    MeshAllocation mesh;
+
+    Object() = default;
+    Object(const Object&) = delete;
+    Object& operator=(const Object&) = delete;
+
+    // objects live by value in the scene's pools; the GL names and the arena allocation go with the move
+    Object(Object&& other) noexcept : pick_id(0) {
+        *this = std::move(other);
+    }
 
-    virtual void draw(const mat4& projection, const mat4& view, bool selected, const mat4& global_transform) {
+    Object& operator=(Object&& other) noexcept {
+        std::swap(name, other.name);
+        std::swap(transform, other.transform);
+        std::swap(VAO, other.VAO);
+        std::swap(VBO, other.VBO);
+        std::swap(EBO, other.EBO);
+        std::swap(shader, other.shader);
+        std::swap(num_edges, other.num_edges);
+        std::swap(index_type, other.index_type);
+        std::swap(kind, other.kind);
+        std::swap(pick_id, other.pick_id);
+        std::swap(in_arena, other.in_arena);
+        std::swap(mesh, other.mesh);
+        std::swap(cached_bounds, other.cached_bounds);
+        std::swap(cached_model, other.cached_model);
+        std::swap(bounds_dirty, other.bounds_dirty);
+        std::swap(follows_selection, other.follows_selection);
+        return *this;
+    }
+
+    [[nodiscard]] unsigned int vertex_array() const {
+        return in_arena ? mesh_arena.VAO : VAO;
+    }
+
+    // projection and view come from the camera uniform block, see CameraBlock in main.cpp
+    const UniformLocations& use_shader(bool selected, const mat4& global_transform) const {
         mat4 model = transform.to_mat4();
+        const UniformLocations& uniforms = ShaderManager::uniforms(shader);
+
+        gl_state.use_program(shader);
 
-        glUseProgram(shader);
+        glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, value_ptr(model * global_transform));
+        glUniform1i(uniforms.selected, selected);
+        glUniform1i(uniforms.batched, false);
+        glUniform1ui(uniforms.object_id, pick_id);
 
-        glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, value_ptr(projection));
-        glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, value_ptr(model * global_transform));
-        glUniform1i(glGetUniformLocation(shader, "u_selected"), selected);
+        return uniforms;
+    }
+
+    void draw_edges() const {
+        gl_state.bind_vertex_array(vertex_array());
+
+        if (in_arena) {
+            glDrawElementsBaseVertex(
+                GL_LINES, mesh.index_count, mesh.index_type, (void*)mesh.index_offset, mesh.first_vertex
+            );
+        } else {
+            glDrawElements(GL_LINES, num_edges * 2, index_type, 0);
+        }
+    }
+
+    virtual void draw(const mat4& projection, const mat4& view, bool selected, const mat4& global_transform) {
+        use_shader(selected, global_transform);
+        draw_edges();
+    }
+
+    // expects the object's VAO to be bound, so that the EBO binding is recorded in it
+    template <typename E>
+    void upload_edges(std::span<const E> edges) {
+        static_assert(sizeof(E) == sizeof(Edge) || sizeof(E) == sizeof(Edge32));
+
+        this->num_edges = edges.size();
+        this->index_type = sizeof(E) == sizeof(Edge) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, edges.size() * sizeof(E), edges.data(), GL_STATIC_DRAW);
+    }
+
+    // Curves and polylines create their VAO, VBO and EBO when they first have vertices to upload, so building a
+    // scene of many curves issues no GL calls and empty ones never own any. Until then VAO is 0 and they draw nothing.
+    void create_buffers() {
+        if (VAO != 0) {
+            return;
+        }
 
-        glDrawElements(GL_LINES, num_edges * 2, GL_UNSIGNED_SHORT, 0);
-        glBindVertexArray(0);
+        glCreateVertexArrays(1, &VAO);
+        glCreateBuffers(1, &VBO);
+        glCreateBuffers(1, &EBO);
+
+        glEnableVertexArrayAttrib(VAO, 0);
+        glVertexArrayAttribFormat(VAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(VAO, 0, 0);
+        glVertexArrayVertexBuffer(VAO, 0, VBO, 0, sizeof(Vertex));
+        glVertexArrayElementBuffer(VAO, EBO);
     }
 
-    virtual void update(
+    // The per-frame update is split in two so that the CPU work of every object can run in parallel. prepare
+    // runs on a job system thread: it may read the scene and the object's own state but must not call GL, and
+    // leaves whatever has to reach the GPU in the object. upload then runs on the main thread, after every
+    // object's prepare of the frame has finished, and issues the GL calls.
+    virtual void prepare(
         const mat4& global_transform,
-        const std::unordered_set<Object*>& selected_objects,
         const mat4& projection,
         const mat4& view,
         unsigned int width,
         unsigned int height
     ) {}
 
+    virtual void upload() {}
+
+    void update(
+        const mat4& global_transform,
+        const mat4& projection,
+        const mat4& view,
+        unsigned int width,
+        unsigned int height
+    ) {
+        prepare(global_transform, projection, view, width, height);
+        upload();
+    }
+
+    [[nodiscard]] mat4 model_matrix(const mat4& global_transform) const {
+        return transform.to_mat4() * global_transform;
+    }
+
+    // World bounds are cached and only recomputed when the model matrix changes or the geometry is marked dirty.
+    // Curves and polylines are marked dirty by the scene when one of their points moves, see DependencyIndex.
+    AABB cached_bounds;
+    mat4 cached_model;
+    bool bounds_dirty = true;
+
+    const AABB& world_bounds(const mat4& global_transform) {
+        const mat4 model = model_matrix(global_transform);
+        if (bounds_dirty || std::memcmp(&model, &cached_model, sizeof(mat4)) != 0) {
+            cached_bounds = bounds(global_transform);
+            cached_model = model;
+            bounds_dirty = false;
+        }
+        return cached_bounds;
+    }
+
+    // set by the scene each frame when the object's geometry moves with the selection transform although the
+    // object itself is not selected
+    bool follows_selection = false;
+
+    // level-of-detail selection shared by the meshes that keep a chain of resolutions
+    static inline bool lod_enabled = true;
+    static constexpr float lodPixelsPerSegment = 6.0f;
+    static constexpr float lodHysteresis = 1.25f;
+
+    // on-screen radius in pixels of a sphere around center, infinite when it reaches behind the camera
+    [[nodiscard]] static float projected_radius(
+        const vec3& center, float world_radius, const mat4& projection, const mat4& view, unsigned int height
+    ) {
+        vec4 clip = mul(projection, mul(view, vec4(center, 1.0f)));
+        if (clip.w <= world_radius) {
+            return std::numeric_limits<float>::max();
+        }
+        return world_radius * projection[1][1] / clip.w * static_cast<float>(height) * 0.5f;
+    }
+
+    // Moves from the current level towards the coarsest one that still gives the projected circle at least one
+    // segment per lodPixelsPerSegment pixels. A finer level is taken as soon as the current one is too coarse,
+    // a coarser one only once it has lodHysteresis times the segments needed, so sizes near a threshold do not flicker.
+    template <typename Segments>
+    [[nodiscard]] static unsigned int select_lod(
+        unsigned int level, unsigned int level_count, float radius_pixels, Segments&& segments
+    ) {
+        if (!lod_enabled) {
+            return 0;
+        }
+
+        const float wanted = 2.0f * M_PIf * radius_pixels / lodPixelsPerSegment;
+
+        while (level > 0 && static_cast<float>(segments(level)) < wanted) {
+            --level;
+        }
+        while (level + 1 < level_count && static_cast<float>(segments(level + 1)) >= wanted * lodHysteresis) {
+            ++level;
+        }
+        return level;
+    }
+
+    // world bounds for the scene BVH, empty for objects that cannot be picked
+    [[nodiscard]] virtual AABB bounds(const mat4& global_transform) const {
+        return {};
+    }
+
+    // nearest hit along the ray; pixels is the tolerance for objects thinner than a pixel
+    virtual bool intersect_ray(const Ray& ray, const mat4& global_transform, float pixels, float& t) const {
+        return false;
+    }
+
+    [[nodiscard]] virtual bool intersects_frustum(const Frustum& frustum, const mat4& global_transform) const {
+        return false;
+    }
+
     virtual ~Object() {
+        if (in_arena) {
+            mesh_arena.free(mesh);
+            in_arena = false;
+        }
+
+        gl_state.forget_vertex_array(VAO);
+        gl_state.forget_array_buffer(VBO);
+
         glDeleteBuffers(1, &VBO);
         glDeleteBuffers(1, &EBO);
         glDeleteVertexArrays(1, &VAO);
@@ -133,76 +318,321 @@ struct Torus : Object {
     float small_radius;
     unsigned int theta_samples;
     unsigned int phi_samples;
+    // procedural tori have no VBO/EBO, the vertex shader builds the wireframe from gl_VertexID
+    bool procedural;
+
+    // level k halves the samples of level k - 1; CPU tori keep every level in the mesh arena
+    static constexpr unsigned int maxLodLevels = 8;
+    static constexpr unsigned int minLodSamples = 3;
+    std::vector<MeshAllocation> lods;
+    unsigned int lod_levels = 1;
+    unsigned int lod = 0;
+
+    // CPU tori build their levels on the mesh builder. Until the levels of mesh_version arrive, lods holds the
+    // previous parameters' levels, or for a new torus a single placeholder of the coarsest level
+    uint64_t mesh_owner = 0;
+    uint64_t mesh_version = 0;
+    bool mesh_pending = false;
 
     Torus(
         float big_radius, float small_radius, unsigned int theta_samples, unsigned int phi_samples,
-        const unsigned int shader, Transform transform = Transform::identity(), const std::string& name = "torus"
+        const unsigned int shader, Transform transform = Transform::identity(), const std::string& name = "torus",
+        bool procedural = false
     )
-    : big_radius(big_radius), small_radius(small_radius), theta_samples(theta_samples), phi_samples(phi_samples) {
+    : big_radius(big_radius), small_radius(small_radius), theta_samples(theta_samples), phi_samples(phi_samples),
+      procedural(procedural) {
         this->transform = transform;
         this->name = name;
-        auto vertices = calc_vertices();
-        auto edges = calc_edges();
-        this->num_edges = edges.size();
         this->shader = shader;
-        this->uid = 1;
+        this->kind = ObjectKind::Torus;
 
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        if (procedural) {
+            glGenVertexArrays(1, &VAO);
+        } else {
+            mesh_owner = mesh_builder.new_owner();
+        }
+        this->in_arena = !procedural;
 
-        glBindVertexArray(VAO);
+        rebuild();
+    }
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    Torus(Torus&&) noexcept = default;
+
+    // swaps like Object's, so the levels this torus held are freed with other
+    Torus& operator=(Torus&& other) noexcept {
+        Object::operator=(std::move(other));
+        std::swap(big_radius, other.big_radius);
+        std::swap(small_radius, other.small_radius);
+        std::swap(theta_samples, other.theta_samples);
+        std::swap(phi_samples, other.phi_samples);
+        std::swap(procedural, other.procedural);
+        std::swap(lods, other.lods);
+        std::swap(lod_levels, other.lod_levels);
+        std::swap(lod, other.lod);
+        std::swap(mesh_owner, other.mesh_owner);
+        std::swap(mesh_version, other.mesh_version);
+        std::swap(mesh_pending, other.mesh_pending);
+        return *this;
+    }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, edges.size() * sizeof(Edge), edges.data(), GL_STATIC_DRAW);
+    ~Torus() override {
+        for (auto& level : lods) {
+            mesh_arena.free(level);
+        }
 
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
+        // mesh is one of the levels, already freed
+        this->in_arena = false;
     }
 
-    [[nodiscard]] std::vector<Vertex> calc_vertices() const {
-        std::vector<Vertex> vertices;
-        vertices.reserve(theta_samples * phi_samples);
+    void set_parameters(float big_radius, float small_radius, unsigned int theta_samples, unsigned int phi_samples) {
+        this->big_radius = big_radius;
+        this->small_radius = small_radius;
+        this->theta_samples = theta_samples;
+        this->phi_samples = phi_samples;
+        this->bounds_dirty = true;
+        rebuild();
+    }
 
-        for (unsigned int i = 0; i <= theta_samples; ++i) {
-            const float theta = 2.0f * M_PIf * static_cast<float>(i) / static_cast<float>(theta_samples);
-            for (unsigned int j = 0; j <= phi_samples; ++j) {
-                const float phi = 2.0f * M_PIf * static_cast<float>(j) / static_cast<float>(phi_samples);
+    [[nodiscard]] std::pair<unsigned int, unsigned int> lod_samples(unsigned int level) const {
+        return {
+            std::max(std::min(minLodSamples, theta_samples), theta_samples >> level),
+            std::max(std::min(minLodSamples, phi_samples), phi_samples >> level)
+        };
+    }
 
-                float x = (big_radius + small_radius * cosf(phi)) * cosf(theta);
-                float y = (big_radius + small_radius * cosf(phi)) * sinf(theta);
-                float z = small_radius * sinf(phi);
+    void rebuild() {
+        lod_levels = 1;
+        while (lod_levels < maxLodLevels && lod_samples(lod_levels) != lod_samples(lod_levels - 1)) {
+            ++lod_levels;
+        }
+        lod = std::min(lod, lod_levels - 1);
 
-                vertices.emplace_back(x, y, z);
+        if (!procedural) {
+            if (lods.empty()) {
+                FrameArena::Scope scratch(frame_arena);
+                auto [theta, phi] = lod_samples(lod_levels - 1);
+                lods.push_back(allocate_mesh(build_mesh(big_radius, small_radius, theta, phi)));
             }
+            request_meshes();
         }
-        return vertices;
+
+        set_lod(lod);
+    }
+
+    void request_meshes() {
+        std::array<std::pair<unsigned int, unsigned int>, maxLodLevels> samples;
+        for (unsigned int level = 0; level < lod_levels; ++level) {
+            samples[level] = lod_samples(level);
+        }
+
+        mesh_pending = true;
+        mesh_builder.submit(
+            mesh_owner, ++mesh_version,
+            [big_radius = big_radius, small_radius = small_radius, samples, levels = lod_levels](std::vector<BuiltMesh>& meshes) {
+                for (unsigned int level = 0; level < levels; ++level) {
+                    FrameArena::Scope scratch(frame_arena);
+                    meshes.push_back(build_mesh(big_radius, small_radius, samples[level].first, samples[level].second));
+                }
+            }
+        );
     }
 
-    [[nodiscard]] std::vector<Edge> calc_edges() const {
-        std::vector<Edge> edges;
-        edges.reserve(theta_samples * phi_samples * 6);
+    // called on the main thread with the levels of the newest request, replaces the levels drawn until now
+    void apply_meshes(const std::vector<BuiltMesh>& levels) {
+        for (auto& level : lods) {
+            mesh_arena.free(level);
+        }
+        lods.clear();
+
+        for (const BuiltMesh& level : levels) {
+            lods.push_back(allocate_mesh(level));
+        }
+        mesh_pending = false;
+        set_lod(lod);
+    }
+
+    [[nodiscard]] static BuiltMesh build_mesh(float big_radius, float small_radius, unsigned int theta, unsigned int phi) {
+        BuiltMesh mesh;
+        auto vertices = torus_vertices(big_radius, small_radius, theta, phi);
+        mesh.vertices.assign(vertices.begin(), vertices.end());
+        if (fitsShortIndices(vertices.size())) {
+            auto edges = torus_edges<Edge>(theta, phi);
+            mesh.edges.assign(edges.begin(), edges.end());
+        } else {
+            auto edges = torus_edges<Edge32>(theta, phi);
+            mesh.edges32.assign(edges.begin(), edges.end());
+        }
+        return mesh;
+    }
+
+    static MeshAllocation allocate_mesh(const BuiltMesh& mesh) {
+        return mesh.edges32.empty() ? mesh_arena.allocate(mesh.vertices, mesh.edges) : mesh_arena.allocate(mesh.vertices, mesh.edges32);
+    }
 
-        for (unsigned int i = 0; i < theta_samples; ++i) {
-            for (unsigned int j = 0; j < phi_samples; ++j) {
-                unsigned int index1 = (i * (phi_samples + 1)) + j;
-                unsigned int index2 = (i * (phi_samples + 1)) + j + 1;
-                unsigned int index3 = ((i + 1) * (phi_samples + 1)) + j;
-                unsigned int index4 = ((i + 1) * (phi_samples + 1)) + j + 1;
+    void set_lod(unsigned int level) {
+        lod = level;
 
-                edges.emplace_back(index1, index2);
-                edges.emplace_back(index2, index3);
-                edges.emplace_back(index3, index1);
+        if (procedural) {
+            // three unique edges per grid cell, see torus_edges
+            auto [theta, phi] = lod_samples(lod);
+            this->num_edges = theta * phi * 3;
+            return;
+        }
+
+        // while the levels are being built there may be fewer of them than lod_levels
+        mesh = lods[std::min<size_t>(lod, lods.size() - 1)];
+        this->num_edges = mesh.index_count / 2;
+        this->index_type = mesh.index_type;
+    }
+
+    void prepare(
+        const mat4& global_transform,
+        const mat4& projection,
+        const mat4& view,
+        unsigned int width,
+        unsigned int height
+    ) override {
+        const mat4 model = model_matrix(global_transform);
+        const vec3 center = vec3_from_vec4(mul(model, vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+        const float scale = std::max({
+            length(vec3_from_vec4(mul(model, vec4(1.0f, 0.0f, 0.0f, 0.0f)))),
+            length(vec3_from_vec4(mul(model, vec4(0.0f, 1.0f, 0.0f, 0.0f)))),
+            length(vec3_from_vec4(mul(model, vec4(0.0f, 0.0f, 1.0f, 0.0f))))
+        });
+
+        // the outer circle has the most on-screen length per segment
+        const float radius = projected_radius(center, (big_radius + small_radius) * scale, projection, view, height);
+        const unsigned int level = select_lod(lod, lod_levels, radius, [&](unsigned int l) {
+            return lod_samples(l).first;
+        });
+
+        if (level != lod) {
+            set_lod(level);
+        }
+    }
+
+    [[nodiscard]] AABB local_bounds() const {
+        const float extent = big_radius + small_radius;
+        return AABB{vec3(-extent, -extent, -small_radius), vec3(extent, extent, small_radius)};
+    }
+
+    [[nodiscard]] AABB bounds(const mat4& global_transform) const override {
+        return local_bounds().transformed(model_matrix(global_transform));
+    }
+
+    // The ray is moved into object space, where the torus is (|p|^2 + R^2 - r^2)^2 = 4 R^2 (x^2 + y^2). Substituting
+    // p = o + t d gives a quartic in t, solved within the part of the ray inside the torus' bounds.
+    bool intersect_ray(const Ray& ray, const mat4& global_transform, float pixels, float& t) const override {
+        const mat4 inverse_model = inverse(model_matrix(global_transform));
+
+        Ray local;
+        local.origin = vec3_from_vec4(mul(inverse_model, vec4(ray.origin, 1.0f)));
+        local.direction = vec3_from_vec4(mul(inverse_model, vec4(ray.direction, 0.0f)));
+
+        // object-space distances are world distances times scale
+        const float scale = length(local.direction);
+        if (scale < 1e-12f) {
+            return false;
+        }
+        local.direction = local.direction / scale;
+
+        float t_near, t_far;
+        if (!intersect_ray_aabb(local, local_bounds(), t_near, t_far)) {
+            return false;
+        }
+
+        const vec3 o = local.origin;
+        const vec3 d = local.direction;
+        const double R2 = static_cast<double>(big_radius) * big_radius;
+        const double k = dot(o, o) + R2 - static_cast<double>(small_radius) * small_radius;
+        const double od = dot(o, d);
+
+        const double coefficients[5] = {
+            k * k - 4.0 * R2 * (o.x * o.x + o.y * o.y),
+            4.0 * od * k - 8.0 * R2 * (o.x * d.x + o.y * d.y),
+            4.0 * od * od + 2.0 * k - 4.0 * R2 * (d.x * d.x + d.y * d.y),
+            4.0 * od,
+            1.0
+        };
+
+        double roots[5];
+        if (polynomial_roots(coefficients, 4, t_near, t_far, roots) == 0) {
+            return false;
+        }
+
+        t = static_cast<float>(roots[0]) / scale;
+        return true;
+    }
+
+    // Tests the drawn wireframe of the current level, so boxes inside the hole or between sparse edges select
+    // nothing. The frustum is moved into object space once and the grid is walked a ring at a time, every vertex
+    // computed once from the rings' sines and cosines.
+    [[nodiscard]] bool intersects_frustum(const Frustum& frustum, const mat4& global_transform) const override {
+        const Frustum local = frustum.to_object_space(model_matrix(global_transform));
+        if (!local.intersects(local_bounds())) {
+            return false;
+        }
+
+        FrameArena::Scope scratch(frame_arena);
+        auto [theta_count, phi_count] = lod_samples(lod);
+
+        auto phi_cos = frame_vector<float>(phi_count);
+        auto phi_sin = frame_vector<float>(phi_count);
+        for (unsigned int j = 0; j < phi_count; ++j) {
+            const float phi = 2.0f * M_PIf * static_cast<float>(j) / static_cast<float>(phi_count);
+            phi_cos.push_back(cosf(phi));
+            phi_sin.push_back(sinf(phi));
+        }
+
+        auto ring = [&](unsigned int i, FrameVector<vec3>& points) {
+            const float theta = 2.0f * M_PIf * static_cast<float>(i % theta_count) / static_cast<float>(theta_count);
+            const float c = cosf(theta);
+            const float s = sinf(theta);
+            points.clear();
+            for (unsigned int j = 0; j < phi_count; ++j) {
+                const float r = big_radius + small_radius * phi_cos[j];
+                points.emplace_back(r * c, r * s, small_radius * phi_sin[j]);
+            }
+        };
 
-                edges.emplace_back(index2, index4);
-                edges.emplace_back(index4, index3);
-                edges.emplace_back(index3, index2);
+        auto current = frame_vector<vec3>(phi_count);
+        auto next = frame_vector<vec3>(phi_count);
+        ring(0, current);
+
+        // the three edges of every cell, as torus_edges emits them
+        for (unsigned int i = 0; i < theta_count; ++i) {
+            ring(i + 1, next);
+            for (unsigned int j = 0; j < phi_count; ++j) {
+                const vec3& p1 = current[j];
+                const vec3& p2 = current[(j + 1) % phi_count];
+                const vec3& p3 = next[j];
+
+                if (local.intersects(p1, p2) || local.intersects(p2, p3) || local.intersects(p3, p1)) {
+                    return true;
+                }
             }
+            std::swap(current, next);
+        }
+        return false;
+    }
+
+    void draw(const mat4& projection, const mat4& view, bool selected, const mat4& global_transform) override {
+        const UniformLocations& uniforms = use_shader(selected, global_transform);
+        glUniform1i(uniforms.procedural, procedural);
+
+        if (procedural) {
+            gl_state.bind_vertex_array(VAO);
+            auto [theta, phi] = lod_samples(lod);
+
+            glUniform1f(uniforms.big_radius, big_radius);
+            glUniform1f(uniforms.small_radius, small_radius);
+            glUniform1ui(uniforms.theta_samples, theta);
+            glUniform1ui(uniforms.phi_samples, phi);
+
+            glDrawArrays(GL_LINES, 0, num_edges * 2);
+        } else {
+            draw_edges();
         }
-        return edges;
     }
 
 };
@@ -215,15 +645,15 @@ struct Cursor : Object {
         auto edges = generateArrowEdges();
         this->num_edges = edges.size();
         this->shader = shader;
-        this->uid = 0;
+        this->kind = ObjectKind::Cursor;
 
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        gl_state.bind_vertex_array(VAO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        gl_state.bind_array_buffer(VBO);
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * 6 * sizeof(float), vertices.data(), GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
@@ -236,6 +666,48 @@ struct Cursor : Object {
         glEnableVertexAttribArray(1);
     }
 
+    [[nodiscard]] std::array<vec3, 6> world_axes(const mat4& global_transform) const {
+        const mat4 model = model_matrix(global_transform);
+        const vec3 origin = vec3_from_vec4(mul(model, vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+        return {
+            origin, vec3_from_vec4(mul(model, vec4(1.0f, 0.0f, 0.0f, 1.0f))),
+            origin, vec3_from_vec4(mul(model, vec4(0.0f, 1.0f, 0.0f, 1.0f))),
+            origin, vec3_from_vec4(mul(model, vec4(0.0f, 0.0f, 1.0f, 1.0f)))
+        };
+    }
+
+    [[nodiscard]] AABB bounds(const mat4& global_transform) const override {
+        AABB result;
+        for (const vec3& p : world_axes(global_transform)) {
+            result.expand(p);
+        }
+        return result;
+    }
+
+    bool intersect_ray(const Ray& ray, const mat4& global_transform, float pixels, float& t) const override {
+        const auto axes = world_axes(global_transform);
+        bool hit = false;
+        t = std::numeric_limits<float>::max();
+        for (unsigned int i = 0; i < axes.size(); i += 2) {
+            float axis_t;
+            if (intersect_ray_polyline(ray, &axes[i], 2, pixels, axis_t) && axis_t < t) {
+                t = axis_t;
+                hit = true;
+            }
+        }
+        return hit;
+    }
+
+    [[nodiscard]] bool intersects_frustum(const Frustum& frustum, const mat4& global_transform) const override {
+        const auto axes = world_axes(global_transform);
+        for (unsigned int i = 0; i < axes.size(); i += 2) {
+            if (frustum.intersects(axes[i], axes[i + 1])) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     static std::array<float, 36> generateArrowVertices() {
         return {
             0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
@@ -261,291 +733,699 @@ struct Point : Object {
     unsigned int samples;
     float radius;
 
+    // spheres of 20, 10, 5 and 3 samples, picked from the projected radius
+    static constexpr unsigned int lodLevels = 4;
+    unsigned int lod = 0;
+
+    struct SharedMesh {
+        std::array<MeshAllocation, lodLevels> lods;
+        unsigned int users = 0;
+    };
+    static inline std::map<float, SharedMesh> shared_meshes;
+
     Point(const unsigned int shader, const float radius = 0.01f, const std::string& name = "point") {
         this->samples = 20;
         this->radius = radius;
         this->transform = Transform::identity();
         this->name = name;
-        auto vertices = calc_vertices();
-        auto edges = calc_edges();
-        this->num_edges = edges.size();
         this->shader = shader;
-        this->uid = 2;
+        this->kind = ObjectKind::Point;
+
+        // every point of the same radius draws the same spheres, so they share one allocation per level in the arena
+        SharedMesh& shared = shared_meshes[radius];
+        if (shared.users++ == 0) {
+            for (unsigned int level = 0; level < lodLevels; ++level) {
+                FrameArena::Scope scratch(frame_arena);
+                const unsigned int level_samples = lod_samples(level);
+                auto vertices = sphere_vertices(radius, level_samples);
+                if (fitsShortIndices(vertices.size())) {
+                    shared.lods[level] = mesh_arena.allocate(vertices, sphere_edges<Edge>(level_samples));
+                } else {
+                    shared.lods[level] = mesh_arena.allocate(vertices, sphere_edges<Edge32>(level_samples));
+                }
+            }
+        }
 
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        this->in_arena = true;
+        set_lod(0);
+    }
+
+    Point(Point&&) noexcept = default;
 
-        glBindVertexArray(VAO);
+    // swaps like Object's, the radius goes with in_arena so each point still releases the mesh it uses
+    Point& operator=(Point&& other) noexcept {
+        Object::operator=(std::move(other));
+        std::swap(samples, other.samples);
+        std::swap(radius, other.radius);
+        std::swap(lod, other.lod);
+        return *this;
+    }
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    // a moved-from point has in_arena cleared and holds no reference
+    ~Point() override {
+        if (!in_arena) {
+            return;
+        }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, edges.size() * sizeof(Edge), edges.data(), GL_STATIC_DRAW);
+        SharedMesh& shared = shared_meshes[radius];
+        if (--shared.users == 0) {
+            for (auto& level : shared.lods) {
+                mesh_arena.free(level);
+            }
+            shared_meshes.erase(radius);
+        }
 
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
+        // the allocation is not ours to free in ~Object
+        this->in_arena = false;
     }
 
-    [[nodiscard]] std::vector<Vertex> calc_vertices() const {
-        std::vector<Vertex> vertices;
-        vertices.reserve(samples * samples);
+    [[nodiscard]] unsigned int lod_samples(unsigned int level) const {
+        return std::max(3u, samples >> level);
+    }
 
-        for (unsigned int i = 0; i <= samples; ++i) {
-            const float theta = 2.0f * M_PIf * static_cast<float>(i) / static_cast<float>(samples);
-            for (unsigned int j = 0; j <= samples; ++j) {
-                const float phi = M_PIf * static_cast<float>(j) / static_cast<float>(samples);
+    void set_lod(unsigned int level) {
+        lod = level;
+        // at() does not insert, prepare calls this from several threads at once
+        this->mesh = shared_meshes.at(radius).lods[lod];
+        this->num_edges = mesh.index_count / 2;
+        this->index_type = mesh.index_type;
+    }
 
-                float x = radius * cosf(theta) * sinf(phi);
-                float y = radius * sinf(theta) * sinf(phi);
-                float z = radius * cosf(phi);
+    void prepare(
+        const mat4& global_transform,
+        const mat4& projection,
+        const mat4& view,
+        unsigned int width,
+        unsigned int height
+    ) override {
+        const mat4 model = model_matrix(global_transform);
+        const float world_radius = length(vec3_from_vec4(mul(model, vec4(radius, 0.0f, 0.0f, 0.0f))));
 
-                vertices.emplace_back(x, y, z);
-            }
+        const float radius_pixels = projected_radius(world_center(global_transform), world_radius, projection, view, height);
+        const unsigned int level = select_lod(lod, lodLevels, radius_pixels, [&](unsigned int l) {
+            return lod_samples(l);
+        });
+
+        if (level != lod) {
+            set_lod(level);
         }
-        return vertices;
     }
 
-    [[nodiscard]] std::vector<Edge> calc_edges() const {
-        std::vector<Edge> edges;
-        edges.reserve(samples * samples * 6);
+    [[nodiscard]] vec3 world_center(const mat4& global_transform) const {
+        return vec3_from_vec4(mul(model_matrix(global_transform), vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+    }
+
+    [[nodiscard]] AABB bounds(const mat4& global_transform) const override {
+        return AABB{vec3(-radius, -radius, -radius), vec3(radius, radius, radius)}.transformed(model_matrix(global_transform));
+    }
 
-        for (unsigned int i = 0; i < samples; ++i) {
-            for (unsigned int j = 0; j < samples; ++j) {
-                unsigned int index1 = (i * (samples + 1)) + j;
-                unsigned int index2 = (i * (samples + 1)) + j + 1;
-                unsigned int index3 = ((i + 1) * (samples + 1)) + j;
-                unsigned int index4 = ((i + 1) * (samples + 1)) + j + 1;
+    // the sphere is grown to the pixel tolerance, points are usually smaller than a pixel
+    bool intersect_ray(const Ray& ray, const mat4& global_transform, float pixels, float& t) const override {
+        const mat4 model = model_matrix(global_transform);
+        const vec3 center = world_center(global_transform);
+        const float world_radius = length(vec3_from_vec4(mul(model, vec4(radius, 0.0f, 0.0f, 0.0f))));
 
-                edges.emplace_back(index1, index2);
-                edges.emplace_back(index2, index3);
-                edges.emplace_back(index3, index1);
+        const float t_closest = dot(center - ray.origin, ray.direction);
+        if (t_closest <= 0.0f) {
+            return false;
+        }
 
-                edges.emplace_back(index2, index4);
-                edges.emplace_back(index4, index3);
-                edges.emplace_back(index3, index2);
-            }
+        const float distance = length(ray.at(t_closest) - center);
+        const float allowed = std::max(world_radius, ray.tolerance(t_closest, pixels));
+        if (distance > allowed) {
+            return false;
         }
-        return edges;
+
+        t = t_closest - std::sqrt(allowed * allowed - distance * distance);
+        return true;
+    }
+
+    [[nodiscard]] bool intersects_frustum(const Frustum& frustum, const mat4& global_transform) const override {
+        return frustum.contains(world_center(global_transform));
     }
 
 };
 
 struct PolyLine : Object {
-    std::vector<Point*> points;
-
-    PolyLine(const unsigned int shader, const std::vector<Point*>& points, const std::string& name = "polyline") {
+    // points are named by their handles in the scene's point pool, a handle of a removed point is skipped
+    const Pool<Point>* point_pool;
+    std::vector<Handle> points;
+    // last uploaded vertices, only the range that differs from it is written on update
+    std::vector<Vertex> uploaded_vertices;
+    // left by prepare for upload: this frame's vertices and the range of them to write, all of them when resized
+    std::vector<Vertex> prepared_vertices;
+    size_t pending_first = 0;
+    size_t pending_end = 0;
+    bool pending_resize = false;
+
+    PolyLine(
+        const unsigned int shader, const Pool<Point>& point_pool, const std::vector<Handle>& points,
+        const std::string& name = "polyline"
+    ) {
+        this->point_pool = &point_pool;
         this->points = points;
         this->transform = Transform::identity();
         this->name = name;
         this->shader = shader;
-        this->uid = 3;
-
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
+        this->kind = ObjectKind::PolyLine;
     }
 
-    [[nodiscard]] std::vector<Vertex> calc_vertices(const mat4& global_transform, const std::unordered_set<Object*>& selected_objects) const {
-        std::vector<Vertex> vertices;
-        vertices.reserve(points.size());
+    [[nodiscard]] FrameVector<Vertex> calc_vertices(const mat4& global_transform) const {
+        auto vertices = frame_vector<Vertex>(points.size());
 
-        for (unsigned int i = 0; i < points.size(); ++i) {
-            mat4 modified_transform = selected_objects.contains(points[i]) ? global_transform : mat4(1.0f);
-            vec4 t_affine = vec4(points[i]->transform.translation, 1.0f);
+        for (Handle handle : points) {
+            const Point* point = point_pool->get(handle);
+            if (!point) {
+                continue;
+            }
+            mat4 modified_transform = point_pool->selected(handle) ? global_transform : mat4(1.0f);
+            vec4 t_affine = vec4(point->transform.translation, 1.0f);
             vec3 t = vec3_from_vec4(mul(modified_transform, t_affine));
             vertices.emplace_back(t);
         }
         return vertices;
     }
 
-    [[nodiscard]] std::vector<Edge> calc_edges() const {
-        std::vector<Edge> edges;
-        edges.reserve(points.size() - 1);
-
-        for (unsigned int i = 0; i < points.size() - 1; ++i) {
-            edges.emplace_back(i, i + 1);
-        }
-        return edges;
-    }
-
-    void update(
+    void prepare(
         const mat4& global_transform,
-        const std::unordered_set<Object*>& selected_objects,
         const mat4& projection,
         const mat4& view,
         unsigned int width,
         unsigned int height
     ) override {
-        auto vertices = calc_vertices(global_transform, selected_objects);
-        auto edges = calc_edges();
-        this->num_edges = edges.size();
+        auto vertices = calc_vertices(global_transform);
+
+        transform = Transform::identity();
+        prepared_vertices.assign(vertices.begin(), vertices.end());
 
-        glBindVertexArray(VAO);
+        if (vertices.size() != uploaded_vertices.size()) {
+            pending_resize = true;
+            return;
+        }
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        size_t first = 0;
+        while (first < vertices.size() && same_position(vertices[first], uploaded_vertices[first])) {
+            ++first;
+        }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, edges.size() * sizeof(Edge), edges.data(), GL_STATIC_DRAW);
+        size_t end = vertices.size();
+        while (end > first && same_position(vertices[end - 1], uploaded_vertices[end - 1])) {
+            --end;
+        }
 
-        transform = Transform::identity();
+        pending_first = first;
+        pending_end = end;
+    }
+
+    void upload() override {
+        if (pending_resize) {
+            create_buffers();
+            gl_state.bind_vertex_array(VAO);
+
+            gl_state.bind_array_buffer(VBO);
+            glBufferData(GL_ARRAY_BUFFER, prepared_vertices.size() * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+            stream_buffer.upload(VBO, 0, prepared_vertices.data(), prepared_vertices.size() * sizeof(Vertex));
+
+            if (fitsShortIndices(prepared_vertices.size())) {
+                upload_edges<Edge>(polyline_edges<Edge>(prepared_vertices.size()));
+            } else {
+                upload_edges<Edge32>(polyline_edges<Edge32>(prepared_vertices.size()));
+            }
+
+            gl_state.bind_vertex_array(0);
+
+            uploaded_vertices.assign(prepared_vertices.begin(), prepared_vertices.end());
+        } else if (pending_first < pending_end) {
+            stream_buffer.upload(
+                VBO, pending_first * sizeof(Vertex), prepared_vertices.data() + pending_first,
+                (pending_end - pending_first) * sizeof(Vertex)
+            );
+            std::copy(
+                prepared_vertices.begin() + pending_first, prepared_vertices.begin() + pending_end,
+                uploaded_vertices.begin() + pending_first
+            );
+        }
+
+        pending_resize = false;
+        pending_first = pending_end = 0;
     }
 
     void draw(const mat4& projection, const mat4& view, bool selected, const mat4& global_transform) override {
+        if (VAO == 0) {
+            return;
+        }
         Object::draw(projection, view, selected, mat4(1.0f));
     }
+
+    // bounds of the points before any pending selection transform, see follows_selection
+    [[nodiscard]] AABB bounds(const mat4& global_transform) const override {
+        AABB result;
+        for (Handle handle : points) {
+            if (const Point* point = point_pool->get(handle)) {
+                result.expand(point->transform.translation);
+            }
+        }
+        return result;
+    }
+
+    // picking tests the vertices prepare and upload left in world space, so global_transform is not applied again
+    bool intersect_ray(const Ray& ray, const mat4& global_transform, float pixels, float& t) const override {
+        return intersect_ray_polyline(ray, uploaded_vertices.data(), uploaded_vertices.size(), pixels, t);
+    }
+
+    [[nodiscard]] bool intersects_frustum(const Frustum& frustum, const mat4& global_transform) const override {
+        return frustum.intersects_polyline(uploaded_vertices.data(), uploaded_vertices.size());
+    }
 };
 
 struct C0Bezier : Object {
-    std::vector<Point*> control_points;
-    PolyLine* control_polygon;
-    std::vector<vec3> curve_vertices;
+    const Pool<Point>* point_pool;
+    std::vector<Handle> control_points;
+    std::unique_ptr<PolyLine> control_polygon;
     bool show_control_polygon = true;
-
-    C0Bezier(const unsigned int shader, const std::vector<Point*>& control_points, const std::string& name = "C0 Bezier") {
+    // this frame's padded control points, in world space
+    std::vector<vec3> world_control_points;
+    static constexpr unsigned int pickSamplesPerSegment = 32;
+
+    // CPU path: every segment owns a slot of its own capacity in curve_vertices and in the VBO, sized at the last
+    // rebuild with room for one more subdivision level, so a segment can be re-evaluated and re-uploaded without
+    // touching its neighbours. The slots are rebuilt when a segment outgrows its own, or when they hold more than
+    // shrinkFactor times the vertices the segments need, so one dense segment does not widen every slot
+    static constexpr unsigned int shrinkFactor = 4;
+    std::vector<vec3> curve_vertices;
+    std::vector<vec3> segment_control_points;
+    std::vector<int> segment_firsts;
+    std::vector<int> segment_samples;
+    std::vector<float> segment_density;
+    std::vector<unsigned int> segment_capacities;
+    // left by prepare for upload: the whole buffer is refilled after a rebuild, otherwise only the dirty segments
+    bool pending_rebuild = false;
+    std::vector<unsigned int> pending_segments;
+
+    // screen-space error allowed between the curve and its polyline, and this frame's share of the global vertex budget
+    float pixel_tolerance = 0.5f;
+    unsigned int vertex_budget = 0;
+
+    // GPU path: control points are drawn as 4-vertex patches and evaluated by the tessellation shaders
+    unsigned int curve_shader;
+    unsigned int tessellation_shader;
+    bool gpu_tessellation = false;
+    std::vector<vec3> patch_control_points;
+    unsigned int num_patches = 0;
+    bool patches_changed = false;
+    bool patches_resized = false;
+    float pixels_per_segment = 4.0f;
+    unsigned int viewport_width = 0;
+    unsigned int viewport_height = 0;
+
+    C0Bezier(
+        const unsigned int shader, const unsigned int tessellation_shader, const Pool<Point>& point_pool,
+        const std::vector<Handle>& control_points, const std::string& name = "C0 Bezier"
+    ) {
+        this->point_pool = &point_pool;
         this->control_points = control_points;
         this->transform = Transform::identity();
         this->name = name;
         this->shader = shader;
-        this->uid = 4;
+        this->curve_shader = shader;
+        this->tessellation_shader = tessellation_shader;
+        this->kind = ObjectKind::Bezier;
 
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        this->control_polygon = std::make_unique<PolyLine>(shader, point_pool, control_points);
+    }
 
-        glBindVertexArray(VAO);
+    void set_gpu_tessellation(bool enabled) {
+        gpu_tessellation = enabled;
+        shader = enabled ? tessellation_shader : curve_shader;
+        // both paths share the VBO, force the next update to refill it
+        patch_control_points.clear();
+        num_patches = 0;
+        segment_samples.clear();
+        segment_density.clear();
+        segment_capacities.clear();
+        pending_segments.clear();
+    }
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+    // control points after the pending selection transform, padded with the last point to 3k + 1 entries
+    [[nodiscard]] FrameVector<vec3> calc_control_points(
+        const mat4& global_transform
+    ) const {
+        auto modified_control_points = frame_vector<vec3>(control_points.size() + 3);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+        for (Handle handle : control_points) {
+            const Point* point = point_pool->get(handle);
+            if (!point) {
+                continue;
+            }
+            mat4 transform = point_pool->selected(handle) ? global_transform : mat4(1.0f);
+            vec3 transformed_point = vec3_from_vec4(mul(transform, vec4(point->transform.translation, 1.0f)));
+            modified_control_points.emplace_back(transformed_point);
+        }
 
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
+        const unsigned int n = modified_control_points.size();
 
-        this->control_polygon = new PolyLine(shader, control_points);
-    }
+        if (n == 0) {
+            return modified_control_points;
+        }
 
-    [[nodiscard]] std::vector<vec3> calc_vertices(
-        const std::vector<vec3>& modified_control_points,
-        const mat4& projection,
-        const mat4& view,
-        unsigned int width,
-        unsigned int height
-    ) const {
-        std::vector<vec3> vertices;
+        unsigned int k = n <= 4 ? 4 - n : (3 - (n - 1) % 3) % 3;
 
-        vertices.reserve(modified_control_points.size());
+        const vec3 last = modified_control_points[n - 1];
+        for (unsigned int i = 0; i < k; ++i) {
+            modified_control_points.emplace_back(last);
+        }
 
-        for (unsigned int i = 0; i < modified_control_points.size() - 1; i+=3) {
-            vec3 p0 = modified_control_points[i];
-            vec3 p1 = modified_control_points[i + 1];
-            vec3 p2 = modified_control_points[i + 2];
-            vec3 p3 = modified_control_points[i + 3];
+        return modified_control_points;
+    }
 
-            vec4 q0 = mul(projection * view, vec4(p0, 1.0f));
-            vec4 q1 = mul(projection * view, vec4(p1, 1.0));
-            vec4 q2 = mul(projection * view, vec4(p2, 1.0));
-            vec4 q3 = mul(projection * view, vec4(p3, 1.0));
+    // control polygon length in pixels, clamped to the viewport, used to split the global vertex budget
+    [[nodiscard]] float projected_size(const mat4& projection_view, unsigned int width, unsigned int height) const {
+        float size = 0.0f;
+        bool has_previous = false;
+        vec3 previous;
 
-            float xMax = std::max({q0.x, q1.x, q2.x, q3.x});
-            float yMax = std::max({q0.y, q1.y, q2.y, q3.y});
+        for (Handle handle : control_points) {
+            const Point* point = point_pool->get(handle);
+            if (!point) {
+                continue;
+            }
+            vec3 screen = to_screen(projection_view, point->transform.translation, width, height);
+            if (screen.z <= nearW) {
+                has_previous = false;
+                continue;
+            }
 
-            float xMin = std::min({q0.x, q1.x, q2.x, q3.x});
-            float yMin = std::min({q0.y, q1.y, q2.y, q3.y});
+            screen.x = std::clamp(screen.x, 0.0f, static_cast<float>(width));
+            screen.y = std::clamp(screen.y, 0.0f, static_cast<float>(height));
 
-            unsigned int points_per_segment = (yMax - yMin) * (xMax - xMin) * 100;
-            points_per_segment = std::max(int(points_per_segment), 2);
+            if (has_previous) {
+                float dx = screen.x - previous.x;
+                float dy = screen.y - previous.y;
+                size += std::sqrt(dx * dx + dy * dy);
+            }
 
-            for (unsigned int j = 0; j < points_per_segment; ++j) {
-                float t = static_cast<float>(j) / static_cast<float>(points_per_segment - 1);
-                vertices.emplace_back(bezierPoint(t, p0, p1, p2, p3));
+            previous = screen;
+            has_previous = true;
+        }
+        return size;
+    }
+
+    [[nodiscard]] bool segment_moved(std::span<const vec3> modified_control_points, unsigned int segment) const {
+        for (unsigned int j = 3 * segment; j <= 3 * segment + 3; ++j) {
+            if (!same_position(modified_control_points[j], segment_control_points[j])) {
+                return true;
             }
         }
-        return vertices;
+        return false;
     }
 
-    [[nodiscard]] std::vector<u16vec2> calc_edges() const {
-        std::vector<u16vec2> edges;
+    void prepare(
+        const mat4& global_transform,
+        const mat4& projection,
+        const mat4& view,
+        unsigned int width,
+        unsigned int height
+    ) override {
+        auto modified_control_points = calc_control_points(global_transform);
+        world_control_points.assign(modified_control_points.begin(), modified_control_points.end());
+
+        if (gpu_tessellation) {
+            prepare_patches(modified_control_points, width, height);
+        } else {
+            prepare_curve(modified_control_points, projection, view, width, height);
+        }
+
+        transform = Transform::identity();
 
-        edges.reserve(curve_vertices.size());
+        if (show_control_polygon) {
+            control_polygon->prepare(global_transform, projection, view, width, height);
+        }
+    }
 
-        for (int i = 0; i < curve_vertices.size() - 1; ++i) {
-            edges.emplace_back(i, i + 1);
+    void upload() override {
+        if (gpu_tessellation) {
+            upload_patches();
+        } else {
+            upload_curve();
         }
 
-        return edges;
+        if (show_control_polygon) {
+            control_polygon->upload();
+        }
     }
 
-    void update(
-        const mat4& global_transform,
-        const std::unordered_set<Object*>& selected_objects,
+    void prepare_curve(
+        std::span<const vec3> modified_control_points,
         const mat4& projection,
         const mat4& view,
         unsigned int width,
         unsigned int height
-    ) override {
-        std::vector<vec3> modified_control_points;
-        modified_control_points.reserve(control_points.size() + 3);
+    ) {
+        // small density changes are ignored so that camera motion does not re-evaluate every segment each frame
+        static constexpr float resample_threshold = 0.25f;
+
+        const unsigned int num_segments = modified_control_points.empty() ? 0 : (modified_control_points.size() - 1) / 3;
+        // myglm multiplies row vectors, so view * projection applies the view first
+        const mat4 projection_view = view * projection;
+
+        auto screen = frame_vector<vec3>();
+        screen.resize(modified_control_points.size());
+        for (unsigned int i = 0; i < modified_control_points.size(); ++i) {
+            screen[i] = to_screen(projection_view, modified_control_points[i], width, height);
+        }
 
-        for (unsigned int i = 0; i < control_points.size(); ++i) {
-            mat4 transform = selected_objects.contains(control_points[i]) ? global_transform : mat4(1.0f);
-            vec3 transformed_point = vec3_from_vec4(mul(transform, vec4(control_points[i]->transform.translation, 1.0f)));
-            modified_control_points.emplace_back(transformed_point);
+        auto density = frame_vector<float>();
+        density.resize(num_segments);
+        float total_vertices = 0.0f;
+        for (unsigned int i = 0; i < num_segments; ++i) {
+            density[i] = calc_segment_density(&screen[3 * i], pixel_tolerance);
+            total_vertices += density[i] + 1.0f;
         }
 
-        const unsigned int n = modified_control_points.size();
+        // over budget: the vertex count goes as 1 / sqrt(tolerance), so coarsen every segment by the same factor
+        float tolerance = pixel_tolerance;
+        if (vertex_budget > 0 && total_vertices > static_cast<float>(vertex_budget)) {
+            const float budget_scale = static_cast<float>(vertex_budget) / total_vertices;
+            for (auto& d : density) {
+                d *= budget_scale;
+            }
+            tolerance /= budget_scale * budget_scale;
+        }
 
-        unsigned int k = n <= 4 ? 4 - n : (4 - n) % 3;
+        bool rebuild = num_segments != segment_density.size();
+
+        auto dirty = frame_vector<bool>();
+        dirty.resize(num_segments, rebuild);
+        auto depths = frame_vector<unsigned int>();
+        depths.resize(num_segments);
+        size_t needed_vertices = 0;
+
+        for (unsigned int i = 0; i < num_segments; ++i) {
+            if (!rebuild) {
+                const float change = std::abs(density[i] - segment_density[i]) / std::max(segment_density[i], 1.0f);
+                if (change <= resample_threshold) {
+                    density[i] = segment_density[i];
+                }
+                dirty[i] = density[i] != segment_density[i] || segment_moved(modified_control_points, i);
+            }
 
-        for (unsigned int i = 0; i < k; ++i) {
-            modified_control_points[n + i] = modified_control_points[n - 1];
+            depths[i] = calc_subdivision_depth(density[i]);
+            const unsigned int needed = (1u << depths[i]) + 1;
+            needed_vertices += needed;
+            if (!rebuild && needed > segment_capacities[i]) {
+                rebuild = true;
+            }
         }
 
-        curve_vertices = calc_vertices(modified_control_points, projection, view, width, height);
-        auto edges = calc_edges();
-        this->num_edges = edges.size();
+        if (!rebuild && curve_vertices.size() > shrinkFactor * needed_vertices) {
+            rebuild = true;
+        }
 
-        glBindVertexArray(VAO);
+        segment_control_points.assign(modified_control_points.begin(), modified_control_points.end());
+        segment_density.assign(density.begin(), density.end());
+        segment_samples.resize(num_segments);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, curve_vertices.size() * sizeof(Vertex), curve_vertices.data(), GL_STATIC_DRAW);
+        if (rebuild) {
+            segment_capacities.resize(num_segments);
+            segment_firsts.resize(num_segments);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, edges.size() * sizeof(Edge), edges.data(), GL_STATIC_DRAW);
+            size_t first = 0;
+            for (unsigned int i = 0; i < num_segments; ++i) {
+                segment_capacities[i] = (1u << std::min(depths[i] + 1, maxSubdivisionDepth)) + 1;
+                segment_firsts[i] = static_cast<int>(first);
+                first += segment_capacities[i];
+            }
+            curve_vertices.resize(first);
 
-        transform = Transform::identity();
+            for (unsigned int i = 0; i < num_segments; ++i) {
+                segment_samples[i] = calc_segment_vertices(
+                    projection_view, width, height, &modified_control_points[3 * i],
+                    tolerance, depths[i], &curve_vertices[segment_firsts[i]]
+                );
+            }
 
-        if (show_control_polygon) {
-            control_polygon->update(global_transform, selected_objects, projection, view, width, height);
+            pending_rebuild = true;
+            pending_segments.clear();
+            return;
+        }
+
+        for (unsigned int i = 0; i < num_segments; ++i) {
+            if (!dirty[i]) {
+                continue;
+            }
+
+            segment_samples[i] = calc_segment_vertices(
+                projection_view, width, height, &modified_control_points[3 * i],
+                tolerance, depths[i], &curve_vertices[segment_firsts[i]]
+            );
+            pending_segments.push_back(i);
+        }
+    }
+
+    void upload_curve() {
+        if (pending_rebuild) {
+            create_buffers();
+            gl_state.bind_array_buffer(VBO);
+            glBufferData(GL_ARRAY_BUFFER, curve_vertices.size() * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+            stream_buffer.upload(VBO, 0, curve_vertices.data(), curve_vertices.size() * sizeof(Vertex));
+        } else {
+            for (unsigned int i : pending_segments) {
+                stream_buffer.upload(
+                    VBO, segment_firsts[i] * sizeof(Vertex), &curve_vertices[segment_firsts[i]],
+                    segment_samples[i] * sizeof(Vertex)
+                );
+            }
         }
+
+        pending_rebuild = false;
+        pending_segments.clear();
+    }
+
+    void draw_curve(const mat4& projection, const mat4& view, bool selected) const {
+        use_shader(selected, mat4(1.0f));
+
+        gl_state.bind_vertex_array(VAO);
+        glMultiDrawArrays(GL_LINE_STRIP, segment_firsts.data(), segment_samples.data(), segment_samples.size());
+    }
+
+    void prepare_patches(std::span<const vec3> modified_control_points, unsigned int width, unsigned int height) {
+        viewport_width = width;
+        viewport_height = height;
+
+        const bool unchanged = std::equal(
+            modified_control_points.begin(), modified_control_points.end(),
+            patch_control_points.begin(), patch_control_points.end(),
+            same_position
+        );
+
+        if (unchanged) {
+            return;
+        }
+
+        patches_changed = true;
+        if (modified_control_points.size() != patch_control_points.size()) {
+            patches_resized = true;
+            num_patches = modified_control_points.empty() ? 0 : (modified_control_points.size() - 1) / 3;
+        }
+
+        patch_control_points.assign(modified_control_points.begin(), modified_control_points.end());
+    }
+
+    void upload_patches() {
+        if (!patches_changed) {
+            return;
+        }
+
+        create_buffers();
+        gl_state.bind_vertex_array(VAO);
+
+        gl_state.bind_array_buffer(VBO);
+
+        if (patches_resized) {
+            glBufferData(GL_ARRAY_BUFFER, patch_control_points.size() * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+            stream_buffer.upload(VBO, 0, patch_control_points.data(), patch_control_points.size() * sizeof(Vertex));
+
+            // consecutive patches share their end points
+            auto patch_indices = frame_vector<unsigned int>(num_patches * 4);
+            for (unsigned int i = 0; i < num_patches; ++i) {
+                for (unsigned int j = 0; j < 4; ++j) {
+                    patch_indices.emplace_back(3 * i + j);
+                }
+            }
+
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, patch_indices.size() * sizeof(unsigned int), patch_indices.data(), GL_STATIC_DRAW);
+        } else {
+            stream_buffer.upload(VBO, 0, patch_control_points.data(), patch_control_points.size() * sizeof(Vertex));
+        }
+
+        gl_state.bind_vertex_array(0);
+
+        patches_changed = false;
+        patches_resized = false;
+    }
+
+    void draw_patches(const mat4& projection, const mat4& view, bool selected) const {
+        const UniformLocations& uniforms = use_shader(selected, mat4(1.0f));
+
+        glUniform2f(uniforms.viewport, viewport_width, viewport_height);
+        glUniform1f(uniforms.pixels_per_segment, pixels_per_segment);
+
+        glPatchParameteri(GL_PATCH_VERTICES, 4);
+
+        gl_state.bind_vertex_array(VAO);
+        glDrawElements(GL_PATCHES, num_patches * 4, GL_UNSIGNED_INT, 0);
     }
 
     void draw(const mat4& projection, const mat4& view, bool selected, const mat4& global_transform) override {
-        Object::draw(projection, view, selected, mat4(1.0f));
+        if (VAO == 0) {
+            // nothing uploaded yet, the control polygon has no vertices either
+            return;
+        }
+        if (gpu_tessellation) {
+            draw_patches(projection, view, selected);
+        } else {
+            draw_curve(projection, view, selected);
+        }
         if (show_control_polygon) {
-            glStencilFunc(GL_ALWAYS, 0, 0xFF);
-            glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
             control_polygon->draw(projection, view, selected, mat4(1.0f));
         }
     }
 
-    ~C0Bezier() override {
-        delete control_polygon;
-        Object::~Object();
+    // the curve lies in the convex hull of its control points; a pending selection transform is not included,
+    // see follows_selection
+    [[nodiscard]] AABB bounds(const mat4& global_transform) const override {
+        AABB result;
+        for (Handle handle : control_points) {
+            if (const Point* point = point_pool->get(handle)) {
+                result.expand(point->transform.translation);
+            }
+        }
+        return result;
+    }
+
+    // uniform samples, independent of the tessellation path and of the camera
+    [[nodiscard]] FrameVector<vec3> pick_polyline() const {
+        const size_t segments = world_control_points.empty() ? 0 : (world_control_points.size() - 1) / 3;
+        auto samples = frame_vector<vec3>(segments * pickSamplesPerSegment + 1);
+
+        for (size_t i = 0; i < segments; ++i) {
+            const vec3* p = &world_control_points[3 * i];
+            for (unsigned int j = i == 0 ? 0 : 1; j <= pickSamplesPerSegment; ++j) {
+                const float t = static_cast<float>(j) / static_cast<float>(pickSamplesPerSegment);
+                samples.push_back(bezierPoint(t, p[0], p[1], p[2], p[3]));
+            }
+        }
+        return samples;
+    }
+
+    bool intersect_ray(const Ray& ray, const mat4& global_transform, float pixels, float& t) const override {
+        const auto samples = pick_polyline();
+        return intersect_ray_polyline(ray, samples.data(), samples.size(), pixels, t);
+    }
+
+    [[nodiscard]] bool intersects_frustum(const Frustum& frustum, const mat4& global_transform) const override {
+        const auto samples = pick_polyline();
+        return frustum.intersects_polyline(samples.data(), samples.size());
     }
 };
\ No newline at end of file
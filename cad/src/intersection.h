@@ -0,0 +1,338 @@
+#pragma once
+
+#include <myglm.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+using namespace myglm;
+
+// false for NaN and infinite coordinates, which no box or tree can hold
+inline bool is_finite(const vec3& p) {
+    return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+}
+
+struct AABB {
+    static constexpr float infinity = std::numeric_limits<float>::max();
+
+    vec3 min = vec3(infinity, infinity, infinity);
+    vec3 max = vec3(-infinity, -infinity, -infinity);
+
+    [[nodiscard]] bool empty() const {
+        return min.x > max.x;
+    }
+
+    void expand(const vec3& p) {
+        min = myglm::min(min, p);
+        max = myglm::max(max, p);
+    }
+
+    void expand(const AABB& other) {
+        min = myglm::min(min, other.min);
+        max = myglm::max(max, other.max);
+    }
+
+    [[nodiscard]] vec3 center() const {
+        return (min + max) * 0.5f;
+    }
+
+    [[nodiscard]] bool operator==(const AABB& other) const {
+        return min.x == other.min.x && min.y == other.min.y && min.z == other.min.z &&
+               max.x == other.max.x && max.y == other.max.y && max.z == other.max.z;
+    }
+
+    // bounds of the box's eight corners after an affine transform
+    [[nodiscard]] AABB transformed(const mat4& model) const {
+        AABB result;
+        if (empty()) {
+            return result;
+        }
+        for (unsigned int corner = 0; corner < 8; ++corner) {
+            vec3 p(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+            result.expand(vec3_from_vec4(mul(model, vec4(p, 1.0f))));
+        }
+        return result;
+    }
+};
+
+// A pick ray through a pixel. spread is the world size of one pixel per unit of distance along the ray, so thin
+// objects (points, curves) can be hit within a tolerance given in pixels.
+struct Ray {
+    vec3 origin;
+    vec3 direction;
+    float spread = 0.0f;
+
+    [[nodiscard]] vec3 at(float t) const {
+        return origin + direction * t;
+    }
+
+    [[nodiscard]] float tolerance(float t, float pixels) const {
+        return spread * pixels * t;
+    }
+
+    // x and y in window coordinates with the origin in the top-left corner
+    static Ray from_screen(const mat4& inverse_projection_view, float x, float y, float width, float height) {
+        auto unproject = [&](float sx, float sy, float z) {
+            vec4 p = mul(inverse_projection_view, vec4(2.0f * sx / width - 1.0f, 1.0f - 2.0f * sy / height, z, 1.0f));
+            return vec3(p.x, p.y, p.z) / p.w;
+        };
+
+        Ray ray;
+        ray.origin = unproject(x, y, -1.0f);
+        ray.direction = normalize(unproject(x, y, 1.0f) - ray.origin);
+
+        vec3 neighbour = normalize(unproject(x + 1.0f, y, 1.0f) - unproject(x + 1.0f, y, -1.0f));
+        ray.spread = length(neighbour - ray.direction);
+        return ray;
+    }
+};
+
+struct Plane {
+    vec3 normal;
+    float d = 0.0f;
+
+    [[nodiscard]] float distance(const vec3& p) const {
+        return dot(normal, p) + d;
+    }
+};
+
+// Six inward-facing planes. from_box restricts the view frustum to a rectangle of the screen (Gribb-Hartmann on the
+// clip-space bounds of the rectangle).
+struct Frustum {
+    std::array<Plane, 6> planes;
+
+    // x0 < x1 and y0 < y1 in normalized device coordinates
+    static Frustum from_box(const mat4& projection_view, float x0, float y0, float x1, float y1) {
+        // mul(M, p) takes its k-th clip coordinate from column k of M
+        auto column = [&](int k) {
+            return vec4(projection_view[0][k], projection_view[1][k], projection_view[2][k], projection_view[3][k]);
+        };
+        const vec4 cx = column(0), cy = column(1), cz = column(2), cw = column(3);
+
+        auto plane = [](const vec4& c) {
+            float norm = length(vec3(c.x, c.y, c.z));
+            return Plane{vec3(c.x, c.y, c.z) / norm, c.w / norm};
+        };
+
+        Frustum frustum;
+        frustum.planes[0] = plane(cx - cw * x0);
+        frustum.planes[1] = plane(cw * x1 - cx);
+        frustum.planes[2] = plane(cy - cw * y0);
+        frustum.planes[3] = plane(cw * y1 - cy);
+        frustum.planes[4] = plane(cz + cw);
+        frustum.planes[5] = plane(cw - cz);
+        return frustum;
+    }
+
+    // The planes in the space model maps to world space. They are not renormalized, so distances stay world
+    // distances and segment tests give the same answer as on the transformed points.
+    [[nodiscard]] Frustum to_object_space(const mat4& model) const {
+        // the distance of mul(model, p) to the plane is the dot product of p with the plane's row-wise product
+        const mat4 rows = transpose(model);
+        Frustum local;
+        for (size_t k = 0; k < planes.size(); ++k) {
+            const vec4 transformed = mul(rows, vec4(planes[k].normal, planes[k].d));
+            local.planes[k] = Plane{vec3(transformed.x, transformed.y, transformed.z), transformed.w};
+        }
+        return local;
+    }
+
+    [[nodiscard]] bool contains(const vec3& p) const {
+        for (const Plane& plane : planes) {
+            if (plane.distance(p) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // conservative: false only when the box lies entirely behind one plane
+    [[nodiscard]] bool intersects(const AABB& box) const {
+        if (box.empty()) {
+            return false;
+        }
+        for (const Plane& plane : planes) {
+            vec3 farthest(
+                plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+                plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+                plane.normal.z >= 0.0f ? box.max.z : box.min.z
+            );
+            if (plane.distance(farthest) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // clips the segment against every plane
+    [[nodiscard]] bool intersects(const vec3& a, const vec3& b) const {
+        float t0 = 0.0f;
+        float t1 = 1.0f;
+        for (const Plane& plane : planes) {
+            float da = plane.distance(a);
+            float db = plane.distance(b);
+            if (da < 0.0f && db < 0.0f) {
+                return false;
+            }
+            if (da < 0.0f) {
+                t0 = std::max(t0, da / (da - db));
+            } else if (db < 0.0f) {
+                t1 = std::min(t1, da / (da - db));
+            }
+            if (t0 > t1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool intersects_polyline(const vec3* points, size_t count) const {
+        if (count == 1) {
+            return contains(points[0]);
+        }
+        for (size_t i = 0; i + 1 < count; ++i) {
+            if (intersects(points[i], points[i + 1])) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// slab test, t_near and t_far are clamped to the part of the ray in front of its origin
+inline bool intersect_ray_aabb(const Ray& ray, const AABB& box, float& t_near, float& t_far) {
+    t_near = 0.0f;
+    t_far = std::numeric_limits<float>::max();
+
+    const float origin[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+    const float direction[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+    const float low[3] = {box.min.x, box.min.y, box.min.z};
+    const float high[3] = {box.max.x, box.max.y, box.max.z};
+
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::abs(direction[axis]) < 1e-12f) {
+            if (origin[axis] < low[axis] || origin[axis] > high[axis]) {
+                return false;
+            }
+            continue;
+        }
+        float inverse = 1.0f / direction[axis];
+        float ta = (low[axis] - origin[axis]) * inverse;
+        float tb = (high[axis] - origin[axis]) * inverse;
+        t_near = std::max(t_near, std::min(ta, tb));
+        t_far = std::min(t_far, std::max(ta, tb));
+        if (t_near > t_far) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Closest approach between the ray and the segment ab. Returns the distance, t is the ray parameter there.
+inline float ray_segment_distance(const Ray& ray, const vec3& a, const vec3& b, float& t) {
+    const vec3 ab = b - a;
+    const vec3 ao = ray.origin - a;
+
+    const float ab_ab = dot(ab, ab);
+    const float ab_d = dot(ab, ray.direction);
+    const float ab_ao = dot(ab, ao);
+    const float d_ao = dot(ray.direction, ao);
+
+    // the direction is unit length
+    const float denominator = ab_ab - ab_d * ab_d;
+    float s = denominator > 1e-12f ? (ab_ao - ab_d * d_ao) / denominator : 0.0f;
+    s = std::clamp(s, 0.0f, 1.0f);
+
+    const vec3 on_segment = a + ab * s;
+    t = std::max(dot(on_segment - ray.origin, ray.direction), 0.0f);
+    return length(ray.at(t) - on_segment);
+}
+
+// nearest t where the ray passes within the pixel tolerance of the polyline
+inline bool intersect_ray_polyline(const Ray& ray, const vec3* points, size_t count, float pixels, float& t) {
+    bool hit = false;
+    t = std::numeric_limits<float>::max();
+
+    for (size_t i = 0; i + 1 < count; ++i) {
+        float segment_t;
+        float distance = ray_segment_distance(ray, points[i], points[i + 1], segment_t);
+        if (segment_t > 0.0f && distance <= ray.tolerance(segment_t, pixels) && segment_t < t) {
+            t = segment_t;
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+inline double evaluate_polynomial(const double* coefficients, int degree, double t) {
+    double result = coefficients[degree];
+    for (int i = degree - 1; i >= 0; --i) {
+        result = result * t + coefficients[i];
+    }
+    return result;
+}
+
+// Real roots of coefficients[0] + coefficients[1] t + ... in [low, high], ascending, degree at most 4. The roots of
+// the derivative split the interval into monotonic pieces, each holding at most one root found by bisection.
+inline int polynomial_roots(const double* coefficients, int degree, double low, double high, double* roots) {
+    while (degree > 0 && coefficients[degree] == 0.0) {
+        --degree;
+    }
+    if (degree == 0) {
+        return 0;
+    }
+    if (degree == 1) {
+        double t = -coefficients[0] / coefficients[1];
+        if (t < low || t > high) {
+            return 0;
+        }
+        roots[0] = t;
+        return 1;
+    }
+
+    double derivative[4];
+    for (int i = 1; i <= degree; ++i) {
+        derivative[i - 1] = i * coefficients[i];
+    }
+
+    double bounds[5];
+    bounds[0] = low;
+    int critical = polynomial_roots(derivative, degree - 1, low, high, bounds + 1);
+    bounds[critical + 1] = high;
+
+    int count = 0;
+    for (int i = 0; i <= critical; ++i) {
+        double a = bounds[i];
+        double b = bounds[i + 1];
+        double fa = evaluate_polynomial(coefficients, degree, a);
+        double fb = evaluate_polynomial(coefficients, degree, b);
+
+        if (fa == 0.0) {
+            if (count == 0 || roots[count - 1] != a) {
+                roots[count++] = a;
+            }
+            continue;
+        }
+        if ((fa < 0.0) == (fb < 0.0)) {
+            continue;
+        }
+
+        for (int iteration = 0; iteration < 64; ++iteration) {
+            double middle = 0.5 * (a + b);
+            double fm = evaluate_polynomial(coefficients, degree, middle);
+            if ((fm < 0.0) == (fa < 0.0)) {
+                a = middle;
+                fa = fm;
+            } else {
+                b = middle;
+            }
+        }
+        roots[count++] = 0.5 * (a + b);
+    }
+
+    if (evaluate_polynomial(coefficients, degree, high) == 0.0 && (count == 0 || roots[count - 1] != high)) {
+        roots[count++] = high;
+    }
+    return count;
+}
@@ -8,11 +8,19 @@
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "utility/scene_framebuffer.h"
 #include "utility/shader_manager.h"
+#include "utility/uniform_buffer.h"
+#include "utility/job_system.h"
+#include "utility/profiler.h"
 #include <geometry.h>
+#include <scene.h>
+#include <scene_file.h>
+#include <scene_json.h>
+#include <render_queue.h>
+#include <bvh.h>
 #include "debugging.h"
 #include <myglm.h>
-#include <unordered_set>
 #include <map>
 #include <random>
 
@@ -52,11 +60,22 @@ unsigned int grid_shader_program;
 unsigned int torus_shader;
 unsigned int cursor_shader;
 unsigned int point_shader;
+unsigned int bezier_shader;
+unsigned int cloud_shader;
 
 // matrices
 auto projection = mat4(1.0f);
 auto view = mat4(1.0f);
 
+// std140 layout of the Camera block declared by the shaders
+struct CameraBlock {
+    mat4 projection;
+    mat4 view;
+};
+
+constexpr unsigned int cameraBlockBinding = 0;
+UniformBuffer<CameraBlock> camera_buffer;
+
 // ImGui Variables
 bool showOptionsMenu = true;
 bool showTransformMenu = false;
@@ -68,13 +87,31 @@ std::chrono::time_point<std::chrono::high_resolution_clock> lastTime;
 int frameCount = 0;
 float fps = 0.0f;
 
-// static objects
-static constexpr auto gridVertices = generateGridVertices(gridSize);
-
-// dynamic objects
-std::vector<Object*> objects = {};
-std::unordered_set<Object*> selected_objects;
+// dynamic objects live in scene, see scene.h
 Cursor* center_point;
+RenderQueue render_queue;
+
+struct PendingPick {
+    bool pending = false;
+    int x_min = 0, x_max = 0;
+    int y_min = 0, y_max = 0;
+};
+PendingPick pick;
+SceneFramebuffer scene_framebuffer;
+PickReadback pick_readback;
+std::vector<unsigned int> picked_ids;
+
+// CPU picking: world bounds and transforms of frame_objects[i] as drawn this frame, and a BVH over the bounds
+BVH scene_bvh;
+std::vector<ObjectRef> frame_objects;
+std::vector<AABB> object_bounds;
+std::vector<mat4> object_global_transforms;
+ObjectRef hovered_object;
+std::vector<bool> object_visible;
+unsigned int culled_objects = 0;
+bool gpu_picking_menu = false;
+constexpr float pickTolerancePixels = 4.0f;
+constexpr double clickPickPixels = 3.0;
 
 // transform window
 float transform_window_trans[3] = {0, 0, 0};
@@ -89,6 +126,28 @@ float big_radius_menu;
 float small_radius_menu;
 int theta_samples_menu;
 int phi_samples_menu;
+bool procedural_menu;
+
+// scene file
+char scene_path_menu[256] = "scene.mgs";
+// the last successful load, for the overlay
+size_t loaded_objects = 0;
+float load_milliseconds = 0.0f;
+
+// point cloud
+char point_cloud_path_menu[256] = "points.ply";
+int point_budget_menu = 4'000'000;
+
+// profiler
+char trace_path_menu[256] = "trace.json";
+int profiler_frame_menu = 0;
+
+// bezier
+bool gpu_tessellation_menu = true;
+constexpr unsigned int curveVertexBudget = 1 << 18;
+
+// visible objects prepared per job, points and tori take well under a microsecond each
+constexpr size_t updateGrain = 64;
 
 // other
 mat4 cursor_relative_mat4 = mat4(1.0f);
@@ -100,17 +159,16 @@ void framebuffer_size_callback(GLFWwindow* window_, int width_, int height_) {
     glViewport(0, 0, width_, height_);
 }
 
+void add_to_selected_curves(Handle point) {
+    scene.curves.selection.for_each([&](size_t i) {
+        scene.add_control_point(scene.curves.handle_of(i), point);
+    });
+}
+
 void add_point() {
-    auto ppoint = new Point(point_shader);
-    objects.push_back(ppoint);
-    for (auto& object : selected_objects) {
-        if (object->uid == 4) {
-            C0Bezier* bezier = dynamic_cast<C0Bezier*>(object);
-            bezier->control_points.push_back(ppoint);
-            bezier->control_polygon->points.push_back(ppoint);
-        }
-    }
-    ppoint->transform = objects[0]->transform;
+    Point point(point_shader);
+    point.transform = scene.cursor().transform;
+    add_to_selected_curves(scene.add(std::move(point)).handle);
 }
 
 void processInput() {
@@ -138,11 +196,8 @@ void processInput() {
     }
 
     if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !cKeyPressed) {
-        for (auto& object : objects) {
-            if (object->uid == 4) {
-                C0Bezier* bezier = dynamic_cast<C0Bezier*>(object);
-                bezier->show_control_polygon = !bezier->show_control_polygon;
-            }
+        for (auto& bezier : scene.curves) {
+            bezier.show_control_polygon = !bezier.show_control_polygon;
         }
         cKeyPressed = true;
     } else if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE) {
@@ -198,6 +253,44 @@ void processInput() {
     }
 }
 
+Ray cursor_ray(double x, double y) {
+    return Ray::from_screen(inverse(view * projection), x, y, width, height);
+}
+
+// nearest object along the ray, bounds come from the last frame
+ObjectRef pick_object(const Ray& ray) {
+    ObjectRef nearest;
+    float nearest_t = std::numeric_limits<float>::max();
+
+    scene_bvh.query_ray(ray, pickTolerancePixels, [&](unsigned int i) {
+        // null for objects removed since the last frame
+        const Object* object = scene.get(frame_objects[i]);
+        float t;
+        if (object && object->intersect_ray(ray, object_global_transforms[i], pickTolerancePixels, t) && t < nearest_t) {
+            nearest_t = t;
+            nearest = frame_objects[i];
+        }
+    });
+    return nearest;
+}
+
+// window coordinates, origin in the top-left corner
+void select_in_box(int x_min, int y_min, int x_max, int y_max) {
+    const float x0 = 2.0f * x_min / width - 1.0f;
+    const float x1 = 2.0f * x_max / width - 1.0f;
+    const float y0 = 1.0f - 2.0f * y_max / height;
+    const float y1 = 1.0f - 2.0f * y_min / height;
+
+    const Frustum frustum = Frustum::from_box(view * projection, x0, y0, x1, y1);
+
+    scene_bvh.query_frustum(frustum, [&](unsigned int i) {
+        const Object* object = scene.get(frame_objects[i]);
+        if (object && object->intersects_frustum(frustum, object_global_transforms[i])) {
+            scene.set_selected(frame_objects[i]);
+        }
+    });
+}
+
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
     if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
         rightMousePressed = true;
@@ -230,30 +323,27 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
             glfwGetCursorPos(window, &lastX, &lastY);
 
             if (!shiftDown) {
-                selected_objects.clear();
+                scene.clear_selection();
             }
 
-
-            int xMin = std::min(boxStartX, lastX);
-            int xMax = std::max(boxStartX, lastX);
-            int yMin = std::min(boxStartY, lastY);
-            int yMax = std::max(boxStartY, lastY);
-
-            static constexpr unsigned int radius = 3;
-
-            int dx = xMax - xMin + radius;
-            int dy = yMax - yMin + radius;
-
-            size_t bufferSize = dx * dy * sizeof(GLubyte) * 2;
-            std::vector<GLubyte> pixels(bufferSize);
-
-            glReadPixels(xMin, height - yMax, dx, dy, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, pixels.data());
-
-            for (auto pixel : pixels) {
-                size_t index = pixel;
-                if (index > 0) {
-                    selected_objects.insert(objects[index - 1]);
+            int x_min = std::min(boxStartX, lastX);
+            int x_max = std::max(boxStartX, lastX);
+            int y_min = std::min(boxStartY, lastY);
+            int y_max = std::max(boxStartY, lastY);
+
+            if (gpu_picking_menu) {
+                // the ids are read back after the next frame's scene pass
+                pick.pending = true;
+                pick.x_min = x_min;
+                pick.x_max = x_max;
+                pick.y_min = y_min;
+                pick.y_max = y_max;
+            } else if (x_max - x_min <= clickPickPixels && y_max - y_min <= clickPickPixels) {
+                if (ObjectRef object = pick_object(cursor_ray(lastX, lastY)); object.valid()) {
+                    scene.set_selected(object);
                 }
+            } else {
+                select_in_box(x_min, y_min, x_max, y_max);
             }
         }
     }
@@ -266,6 +356,28 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 }
 
+void request_pick() {
+    static constexpr int radius = 3;
+
+    int dx = pick.x_max - pick.x_min + radius;
+    int dy = pick.y_max - pick.y_min + radius;
+
+    pick_readback.request(scene_framebuffer, pick.x_min, height - pick.y_max, dx, dy);
+    pick.pending = false;
+}
+
+void apply_pick() {
+    if (!pick_readback.poll(picked_ids)) {
+        return;
+    }
+
+    scene.for_each([](Object& object, ObjectRef ref) {
+        if (std::binary_search(picked_ids.begin(), picked_ids.end(), object.pick_id)) {
+            scene.set_selected(ref);
+        }
+    });
+}
+
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     orbit_distance -= (float)yoffset * zoomSensitivity;
     if (orbit_distance < 1.0f)
@@ -277,25 +389,136 @@ void render_fps_counter() {
     ImGui::SetNextWindowBgAlpha(0.35f);
     ImGui::Begin("FPS", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav);
     ImGui::Text("FPS: %.1f", fps);
+    ImGui::Text("GL state changes: %u (skipped %u)", gl_state.changes, gl_state.skipped);
+    ImGui::Text("Indirect batches: %u (%u draws)", render_queue.batches, render_queue.batched_draws);
+    ImGui::Text("Culled: %u / %zu", culled_objects, scene.size());
+    ImGui::Text("Frame arena: %zu / %zu KiB", frame_arena.used() >> 10, frame_arena.capacity >> 10);
+    if (loaded_objects > 0) {
+        ImGui::Text("Scene load: %zu objects in %.1f ms", loaded_objects, load_milliseconds);
+    }
+    for (const PointCloud& cloud : scene.clouds) {
+        ImGui::Text("%s: %zu / %zu points%s", cloud.name.c_str(), cloud.drawn_points, cloud.point_count,
+                    cloud.loading() ? " (loading)" : "");
+    }
+    const Object* hovered = scene.get(hovered_object);
+    ImGui::Text("Hovered: %s", hovered ? hovered->name.c_str() : "-");
     ImGui::End();
 }
 
-void add_torus(Torus* torus, bool in_cursor = true, bool select = false) {
-    objects.push_back(torus);
+// Frame time history and the timeline of one recorded frame: CPU zones stacked by depth, GPU passes end to end
+// in the row below them. Hovering a bar shows its time.
+void render_profiler_window() {
+    ImGui::Begin("Profiler", nullptr, ImGuiWindowFlags_NoCollapse);
+
+    ImGui::Checkbox("pause", &profiler.paused);
+    ImGui::InputText("trace", trace_path_menu, IM_ARRAYSIZE(trace_path_menu));
+    ImGui::SameLine();
+    if (ImGui::Button("Export")) {
+        profiler.export_trace(trace_path_menu);
+    }
+
+    const int recorded = static_cast<int>(profiler.recorded);
+    if (recorded == 0) {
+        ImGui::End();
+        return;
+    }
+
+    // oldest on the left
+    std::array<float, Profiler::historyFrames> frame_times;
+    for (int i = 0; i < recorded; ++i) {
+        frame_times[i] = static_cast<float>(profiler.frame(recorded - 1 - i)->duration);
+    }
+    ImGui::PlotLines("##frame times", frame_times.data(), recorded, 0, "CPU frame (ms)", 0.0f, FLT_MAX, ImVec2(-1.0f, 60.0f));
+
+    profiler_frame_menu = std::min(profiler_frame_menu, recorded - 1);
+    ImGui::SliderInt("frames ago", &profiler_frame_menu, 0, recorded - 1);
+    const Profiler::Frame& frame = *profiler.frame(profiler_frame_menu);
+
+    double gpu_total = 0.0;
+    for (const Profiler::GpuPass& pass : frame.gpu_passes) {
+        gpu_total += pass.duration;
+    }
+    if (frame.gpu_ready) {
+        ImGui::Text("CPU %.2f ms, GPU %.2f ms", frame.duration, gpu_total);
+    } else {
+        ImGui::Text("CPU %.2f ms, GPU pending", frame.duration);
+    }
+
+    const double span = std::max(frame.duration, gpu_total);
+    unsigned int rows = 0;
+    for (const Profiler::Zone& zone : frame.zones) {
+        rows = std::max(rows, zone.depth + 1);
+    }
+
+    const float row_height = ImGui::GetTextLineHeightWithSpacing();
+    const float timeline_width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+    auto bar = [&](const char* name, double begin, double end, unsigned int row, ImU32 color) {
+        const ImVec2 min(origin.x + static_cast<float>(begin / span) * timeline_width, origin.y + row * row_height);
+        const ImVec2 max(
+            std::max(origin.x + static_cast<float>(end / span) * timeline_width, min.x + 1.0f), min.y + row_height - 1.0f
+        );
+        draw_list->AddRectFilled(min, max, color);
+        draw_list->PushClipRect(min, max, true);
+        draw_list->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_WHITE, name);
+        draw_list->PopClipRect();
+        if (ImGui::IsMouseHoveringRect(min, max)) {
+            ImGui::SetTooltip("%s: %.3f ms", name, end - begin);
+        }
+    };
+
+    if (span > 0.0) {
+        for (const Profiler::Zone& zone : frame.zones) {
+            bar(zone.name, zone.begin, zone.end, zone.depth, IM_COL32(70, 110, 170, 255));
+        }
+        double gpu_begin = 0.0;
+        for (const Profiler::GpuPass& pass : frame.gpu_passes) {
+            bar(pass.name, gpu_begin, gpu_begin + pass.duration, rows, IM_COL32(170, 100, 60, 255));
+            gpu_begin += pass.duration;
+        }
+    }
+    ImGui::Dummy(ImVec2(timeline_width, static_cast<float>(rows + 1) * row_height));
+
+    ImGui::End();
+}
+
+void add_torus(Torus torus, bool in_cursor = true, bool select = false) {
     if (in_cursor) {
-        torus->transform = objects[0]->transform;
+        torus.transform = scene.cursor().transform;
     }
+    ObjectRef ref = scene.add(std::move(torus));
     if (select) {
-        selected_objects.clear();
-        selected_objects.insert(torus);
+        scene.clear_selection();
+        scene.set_selected(ref);
+    }
+}
+
+std::vector<Handle> selected_points() {
+    std::vector<Handle> points;
+    scene.points.selection.for_each([&](size_t i) {
+        points.push_back(scene.points.handle_of(i));
+    });
+    return points;
+}
+
+using SceneLoader = bool (*)(const char* path, Scene& scene, const SceneShaders& shaders);
+
+// a failed load leaves the scene and the overlay's last load as they were
+void open_scene(SceneLoader load) {
+    ProfileZone zone("scene load");
+    auto start = std::chrono::high_resolution_clock::now();
+    if (load(scene_path_menu, scene, {cursor_shader, torus_shader, point_shader, bezier_shader, gpu_tessellation_menu})) {
+        load_milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        loaded_objects = scene.size();
     }
 }
 
 void render_options_menu() {
     ImGui::Begin("Options", nullptr, ImGuiWindowFlags_NoCollapse);
     if (ImGui::Button("Torus")) {
-        auto ptorus = new Torus(1.0f, 0.1f, 25, 25, torus_shader);
-        add_torus(ptorus);
+        add_torus(Torus(1.0f, 0.1f, 25, 25, torus_shader));
     }
 
     if (ImGui::Button("Point")) {
@@ -303,28 +526,50 @@ void render_options_menu() {
     }
 
     if (ImGui::Button("Polyline")) {
-        std::vector<Point*> points;
-        for (auto& object : selected_objects) {
-            if (object->uid == 2) {
-                points.push_back(dynamic_cast<Point*>(object));
-            }
-        }
+        std::vector<Handle> points = selected_points();
         if (points.size() >= 2) {
-            auto ppolyline = new PolyLine(point_shader, points);
-            objects.push_back(ppolyline);
+            scene.add(PolyLine(point_shader, scene.points, points));
         }
     }
 
     if (ImGui::Button("C0 Bezier")) {
-        std::vector<Point*> points;
-        for (auto& object : selected_objects) {
-            if (object->uid == 2) {
-                points.push_back(dynamic_cast<Point*>(object));
-            }
+        C0Bezier bezier(point_shader, bezier_shader, scene.points, selected_points());
+        bezier.set_gpu_tessellation(gpu_tessellation_menu);
+        scene.add(std::move(bezier));
+    }
+
+    ImGui::InputText("file", scene_path_menu, IM_ARRAYSIZE(scene_path_menu));
+    if (ImGui::Button("Save")) {
+        save_scene_file(scene_path_menu, scene);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Open")) {
+        open_scene(load_scene_file);
+    }
+    if (ImGui::Button("Save JSON")) {
+        save_scene_json(scene_path_menu, scene);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Open JSON")) {
+        open_scene(load_scene_json);
+    }
+
+    ImGui::InputText("point cloud", point_cloud_path_menu, IM_ARRAYSIZE(point_cloud_path_menu));
+    if (ImGui::Button("Import point cloud")) {
+        PointCloud cloud(cloud_shader, std::filesystem::path(point_cloud_path_menu).filename().string());
+        if (cloud.load(point_cloud_path_menu)) {
+            scene.add(std::move(cloud));
         }
+    }
+    ImGui::SliderInt("point budget", &point_budget_menu, 100'000, 20'000'000, "%d", ImGuiSliderFlags_Logarithmic);
 
-        auto pc0bezier = new C0Bezier(point_shader, points);
-        objects.push_back(pc0bezier);
+    ImGui::Checkbox("GPU picking", &gpu_picking_menu);
+    ImGui::Checkbox("Level of detail", &Object::lod_enabled);
+
+    if (ImGui::Checkbox("GPU tessellation", &gpu_tessellation_menu)) {
+        for (auto& bezier : scene.curves) {
+            bezier.set_gpu_tessellation(gpu_tessellation_menu);
+        }
     }
 
     ImGui::End();
@@ -332,7 +577,7 @@ void render_options_menu() {
 
 void render_single_object_transform_menu() {
     ImGui::Begin("Local Transform", &showTransformMenu);
-    auto& selected_obj = *selected_objects.begin();
+    Object* selected_obj = scene.get(scene.first_selected());
 
     transform_window_trans[0] = selected_obj->transform.translation.x;
     transform_window_trans[1] = selected_obj->transform.translation.y;
@@ -379,11 +624,15 @@ void render_transform_around_cursor_menu() {
     }
 
     if (ImGui::Button("apply")) {
-        for (auto& object : objects) {
-            if (object->uid > 0 && selected_objects.contains(object)) {
-                object->transform = Transform::from_mat4(object->transform.to_mat4() * cursor_relative_mat4);
+        scene.for_each_selected([](Object& object, ObjectRef ref) {
+            if (ref.kind != ObjectKind::Cursor) {
+                object.transform = Transform::from_mat4(object.transform.to_mat4() * cursor_relative_mat4);
             }
-        }
+            // the point stays where the pending transform drew it, but its curves' bounds are taken without it
+            if (ref.kind == ObjectKind::Point) {
+                scene.point_moved(ref.handle);
+            }
+        });
 
         cursor_relative_transform = Transform::identity();
     }
@@ -406,11 +655,15 @@ void render_transform_around_center_menu() {
     }
 
     if (ImGui::Button("apply")) {
-        for (auto& object : objects) {
-            if (object->uid > 0 && selected_objects.contains(object)) {
-                object->transform = Transform::from_mat4(object->transform.to_mat4() * center_point_relative_mat4);
+        scene.for_each_selected([](Object& object, ObjectRef ref) {
+            if (ref.kind != ObjectKind::Cursor) {
+                object.transform = Transform::from_mat4(object.transform.to_mat4() * center_point_relative_mat4);
             }
-        }
+            // the point stays where the pending transform drew it, but its curves' bounds are taken without it
+            if (ref.kind == ObjectKind::Point) {
+                scene.point_moved(ref.handle);
+            }
+        });
 
         center_point_relative_transform = Transform::identity();
     }
@@ -420,15 +673,18 @@ void render_transform_around_center_menu() {
 
 void render_objects_list_window() {
     ImGui::Begin("Objects", nullptr, ImGuiWindowFlags_NoCollapse);
-    for (int i = 0; i < objects.size(); ++i) {
-        auto& obj = objects[i];
+    ObjectRef removed;
+
+    for (int i = 0; i < scene.order.size(); ++i) {
+        const ObjectRef ref = scene.order[i];
+        Object* obj = scene.get(ref);
         std::string& item_name = obj->name;
         char buffer[256];
         strcpy(buffer, item_name.c_str());
 
         ImGui::PushID(i); // Unique ID for each item
 
-        bool style_selected = selected_objects.contains(obj);
+        bool style_selected = scene.selected(ref);
 
         if (style_selected) {
             ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(1.0f, 1.0f, 0.8f, 0.2f));
@@ -444,64 +700,39 @@ void render_objects_list_window() {
 
         if (ImGui::IsItemClicked()) {
             if (!shiftDown) {
-                selected_objects.clear();
+                scene.clear_selection();
             }
 
-            selected_objects.insert(objects[i]);
+            scene.set_selected(ref);
 
-            if (leftCtrlDown && objects[i]->uid == 2) {
-                Point* point = dynamic_cast<Point*>(objects[i]);
-                for (auto& object : selected_objects) {
-                    if (object->uid == 4) {
-                        C0Bezier* bezier = dynamic_cast<C0Bezier*>(object);
-                        bezier->control_points.push_back(point);
-                        bezier->control_polygon->points.push_back(point);
-                    }
-                }
+            if (leftCtrlDown && ref.kind == ObjectKind::Point) {
+                add_to_selected_curves(ref.handle);
             }
         }
 
-        if (item_name != "cursor") {
+        if (ref.kind != ObjectKind::Cursor) {
             ImGui::SameLine();
             if (ImGui::Button("X")) {
-
-                if (obj->uid == 2) {
-                    for (auto& object : objects) {
-                        if (object->uid == 4) {
-                            C0Bezier* bezier = dynamic_cast<C0Bezier*>(object);
-                            int idx = -1;
-                            for (int i = 0; i < bezier->control_points.size(); i++) {
-                                auto point = bezier->control_points[i];
-                                if (point == obj) {
-                                    idx = i;
-                                    break;
-                                }
-                            }
-                            if (idx >= 0) {
-                                bezier->control_points.erase(bezier->control_points.begin() + idx);
-                                bezier->control_polygon->points.erase(bezier->control_polygon->points.begin() + idx);
-                            }
-                        }
-                    }
-                }
-
-                delete obj;
-                objects.erase(objects.begin() + i);
-                selected_objects.clear();
+                removed = ref;
             }
         }
 
         ImGui::PopID();
     }
 
+    // removed after the loop, removal reorders the pools and the list
+    if (removed.valid()) {
+        scene.remove(removed);
+        scene.clear_selection();
+    }
+
     ImGui::End();
 }
 
 void render_torus_menu() {
     ImGui::Begin("Torus", nullptr, ImGuiWindowFlags_NoCollapse);
 
-    auto& basePtr = *selected_objects.begin();
-    Torus* obj = dynamic_cast<Torus*>(basePtr);
+    Torus* obj = scene.tori.get(scene.first_selected().handle);
 
     big_radius_menu = obj->big_radius;
     small_radius_menu = obj->small_radius;
@@ -509,56 +740,48 @@ void render_torus_menu() {
     phi_samples_menu = obj->phi_samples;
 
     if (ImGui::SliderFloat("R", &big_radius_menu, 0.1f, 5.0f) ) {
-        auto ptorus = new Torus(big_radius_menu, obj->small_radius, obj->theta_samples, obj->phi_samples, torus_shader, obj->transform, obj->name);
-        objects.erase(std::remove(objects.begin(), objects.end(), obj), objects.end());
-        delete obj;
-        selected_objects.erase(obj);
-        add_torus(ptorus, false, true);
+        obj->set_parameters(big_radius_menu, obj->small_radius, obj->theta_samples, obj->phi_samples);
     }
 
     if (ImGui::SliderFloat("r", &small_radius_menu, 0.1f, 5.0f) ) {
-        auto ptorus = new Torus(obj->big_radius, small_radius_menu, obj->theta_samples, obj->phi_samples, torus_shader, obj->transform, obj->name);
-        objects.erase(std::remove(objects.begin(), objects.end(), obj), objects.end());
-        delete obj;
-        selected_objects.erase(obj);
-        add_torus(ptorus, false, true);
+        obj->set_parameters(obj->big_radius, small_radius_menu, obj->theta_samples, obj->phi_samples);
     }
 
-    if (ImGui::SliderInt("theta", &theta_samples_menu, 3, 100) ) {
-        auto ptorus = new Torus(obj->big_radius, obj->small_radius, theta_samples_menu, obj->phi_samples, torus_shader, obj->transform, obj->name);
-        objects.erase(std::remove(objects.begin(), objects.end(), obj), objects.end());
-        delete obj;
-        selected_objects.erase(obj);
-        add_torus(ptorus, false, true);
+    if (ImGui::SliderInt("theta", &theta_samples_menu, minTorusSamples, maxTorusSamples) ) {
+        obj->set_parameters(obj->big_radius, obj->small_radius, theta_samples_menu, obj->phi_samples);
     }
 
-    if (ImGui::SliderInt("phi", &phi_samples_menu, 3, 100) ) {
-        auto ptorus = new Torus(obj->big_radius, obj->small_radius, obj->theta_samples, phi_samples_menu, torus_shader, obj->transform, obj->name);
-        objects.erase(std::remove(objects.begin(), objects.end(), obj), objects.end());
-        delete obj;
-        selected_objects.erase(obj);
-        add_torus(ptorus, false, true);
+    if (ImGui::SliderInt("phi", &phi_samples_menu, minTorusSamples, maxTorusSamples) ) {
+        obj->set_parameters(obj->big_radius, obj->small_radius, obj->theta_samples, phi_samples_menu);
+    }
+
+    procedural_menu = obj->procedural;
+
+    if (ImGui::Checkbox("procedural", &procedural_menu)) {
+        // swapped into the same slot, so the handle and the selection stay; the old torus is destroyed with the temporary
+        Torus replacement(obj->big_radius, obj->small_radius, obj->theta_samples, obj->phi_samples, torus_shader, obj->transform, obj->name, procedural_menu);
+        std::swap(*obj, replacement);
     }
 
     ImGui::End();
 }
 
 bool is_torus_selected() {
-    return (selected_objects.size() == 1) && ((*selected_objects.begin())->uid == 1);
+    return scene.selection_count() == 1 && scene.tori.selection.count == 1;
 }
 
 void render_gui() {
-    if (selected_objects.size() == 1) {
+    if (scene.selection_count() == 1) {
         render_single_object_transform_menu();
     }
 
-    if (!selected_objects.empty()) {
+    if (scene.selection_count() > 0) {
         render_transform_around_cursor_menu();
     } else {
         cursor_relative_transform = Transform::identity();
     }
 
-    if (selected_objects.size() >= 2) {
+    if (scene.selection_count() >= 2) {
         render_transform_around_center_menu();
     } else {
         center_point_relative_transform = Transform::identity();
@@ -571,37 +794,99 @@ void render_gui() {
     render_options_menu();
     render_objects_list_window();
     render_fps_counter();
+    render_profiler_window();
 }
 
-unsigned int gridVAO, gridVBO;
+void distribute_curve_vertex_budget() {
+    mat4 projection_view = view * projection;
+
+    auto curves = frame_vector<std::pair<C0Bezier*, float>>(scene.curves.size());
+    float total_size = 0.0f;
 
-void initializeGridBuffers() {
-    glGenVertexArrays(1, &gridVAO);
-    glGenBuffers(1, &gridVBO);
+    for (auto& bezier : scene.curves) {
+        if (!bezier.gpu_tessellation) {
+            float size = bezier.projected_size(projection_view, width, height);
+            curves.emplace_back(&bezier, size);
+            total_size += size;
+        }
+    }
+
+    for (auto& [bezier, size] : curves) {
+        float share = total_size > 0.0f ? size / total_size : 0.0f;
+        bezier->vertex_budget = std::max(1u, static_cast<unsigned int>(share * curveVertexBudget));
+    }
+}
 
-    glBindVertexArray(gridVAO);
+// splits the global point budget between the clouds by their size on screen
+void distribute_point_budget() {
+    auto clouds = frame_vector<std::pair<PointCloud*, float>>(scene.clouds.size());
+    float total_size = 0.0f;
+
+    for (auto& cloud : scene.clouds) {
+        const AABB bounds = cloud.bounds(mat4(1.0f));
+        float size = 0.0f;
+        if (!bounds.empty()) {
+            const float radius = length(bounds.max - bounds.min) * 0.5f;
+            size = std::min(Object::projected_radius(bounds.center(), radius, projection, view, height), static_cast<float>(height));
+        }
+        clouds.emplace_back(&cloud, size);
+        total_size += size;
+    }
+
+    for (auto& [cloud, size] : clouds) {
+        float share = total_size > 0.0f ? size / total_size : 1.0f / static_cast<float>(clouds.size());
+        cloud->point_budget = static_cast<size_t>(share * static_cast<float>(point_budget_menu));
+    }
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
-    glBufferData(GL_ARRAY_BUFFER, gridVertices.size() * sizeof(vec3), gridVertices.data(), GL_STATIC_DRAW);
+// Uploads the torus levels built since the last frame. Results of requests that were superseded in the meantime,
+// or whose torus was removed, are dropped.
+void upload_built_meshes() {
+    ProfileZone zone("mesh uploads");
+    auto built = frame_vector<BuiltMeshes>();
+    BuiltMeshes meshes;
+    while (mesh_builder.take(meshes)) {
+        built.push_back(std::move(meshes));
+    }
+    if (built.empty()) {
+        return;
+    }
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    std::sort(built.begin(), built.end(), [](const BuiltMeshes& a, const BuiltMeshes& b) {
+        return a.owner < b.owner;
+    });
 
-    glBindVertexArray(0);
+    for (Torus& torus : scene.tori) {
+        if (!torus.mesh_pending) {
+            continue;
+        }
+        auto found = std::lower_bound(built.begin(), built.end(), torus.mesh_owner, [](const BuiltMeshes& b, uint64_t owner) {
+            return b.owner < owner;
+        });
+        for (; found != built.end() && found->owner == torus.mesh_owner; ++found) {
+            if (found->version == torus.mesh_version) {
+                torus.apply_meshes(found->levels);
+                break;
+            }
+        }
+    }
 }
 
-void render_grid() {
-    glStencilFunc(GL_ALWAYS, 0, 0xFF);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+// the grid has no vertex data, but core profile draws need a bound VAO
+unsigned int gridVAO;
 
-    glUseProgram(grid_shader_program);
+void initializeGrid() {
+    glCreateVertexArrays(1, &gridVAO);
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(grid_shader_program, "projection"), 1, GL_FALSE, value_ptr(projection));
-    glUniformMatrix4fv(glGetUniformLocation(grid_shader_program, "view"), 1, GL_FALSE, value_ptr(view));
+void render_grid() {
+    gl_state.use_program(grid_shader_program);
+    gl_state.bind_vertex_array(gridVAO);
 
-    glBindVertexArray(gridVAO);
-    glDrawArrays(GL_LINES, 0, gridVertices.size());
-    glBindVertexArray(0);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDisable(GL_BLEND);
 }
 
 int main() {
@@ -610,7 +895,6 @@ int main() {
         return -1;
     }
 
-    glfwWindowHint(GLFW_SAMPLES, 8);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -641,9 +925,16 @@ int main() {
     ImGui_ImplOpenGL3_Init("#version 460");
 
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_STENCIL_TEST);
 
-    initializeGridBuffers();
+    initializeGrid();
+    stream_buffer.init(8 << 20);
+    camera_buffer.init(cameraBlockBinding);
+    mesh_arena.init(1 << 16, 1 << 20);
+    scene_framebuffer.init(width, height);
+    // the main thread runs jobs too, one worker per remaining core
+    job_system.start(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    mesh_builder.start(MeshBuilder::maxWorkers);
+    profiler.init();
 
     lastTime = std::chrono::high_resolution_clock::now();
 
@@ -651,17 +942,33 @@ int main() {
     cursor_shader = shader_manager.shader_program({"cursor"});
     torus_shader = shader_manager.shader_program({"torus"});
     point_shader = shader_manager.shader_program({"point"});
+    bezier_shader = shader_manager.shader_program({"bezier"});
+    cloud_shader = shader_manager.shader_program({"cloud"});
 
-    objects.emplace_back(new Cursor(cursor_shader));
+    scene.add(Cursor(cursor_shader));
 
     center_point = new Cursor(cursor_shader);
 
     glEnable(GL_PROGRAM_POINT_SIZE);
 
     while (!glfwWindowShouldClose(window)) {
+        profiler.begin_frame();
+
+        profiler.begin_zone("input");
         processInput();
-        glClearColor(0.2f, 0.2f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        profiler.end_zone();
+
+        frame_arena.reset();
+        stream_buffer.begin_frame();
+        gl_state.begin_frame();
+
+        profiler.begin_zone("picking");
+        apply_pick();
+        profiler.end_zone();
+
+        static constexpr float clear_color[4] = {0.2f, 0.2f, 0.3f, 1.0f};
+        scene_framebuffer.resize(width, height);
+        scene_framebuffer.begin(clear_color);
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -680,9 +987,17 @@ int main() {
 
         view = lookAt(camera_position, target_position, vec3(0.0f, 1.0f, 0.0f));
 
+        camera_buffer.update({projection, view});
+
+        profiler.begin_zone("grid");
+        profiler.begin_gpu_pass("grid");
         render_grid();
+        profiler.end_gpu_pass();
+        profiler.end_zone();
+
+        profiler.begin_zone("update");
 
-        vec3 cursor_translation = objects[0]->transform.translation;
+        vec3 cursor_translation = scene.cursor().transform.translation;
         cursor_relative_mat4 = trans_mat(-cursor_translation) * cursor_relative_transform.to_mat4() * trans_mat(cursor_translation);
 
         vec3 center_point_translation = center_point->transform.translation;
@@ -690,29 +1005,138 @@ int main() {
 
         mat4 relative_transform = cursor_relative_mat4 * center_point_relative_mat4;
 
-        for (int i = 0; i < objects.size(); i++) {
-            auto& object = objects[i];
+        profiler.begin_zone("budgets");
+        distribute_curve_vertex_budget();
+        distribute_point_budget();
+        profiler.end_zone();
 
-            glStencilFunc(GL_ALWAYS, i + 1, 0xFF);
-            glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+        render_queue.clear();
+        frame_objects.clear();
+        object_bounds.clear();
+        object_global_transforms.clear();
 
-            object->update(relative_transform, selected_objects, projection, view, width, height);
-            mat4 global_transform = selected_objects.contains(object) ? relative_transform : mat4(1.0f);
-            object->draw(projection, view, selected_objects.contains(object), global_transform);
+        scene.update_following();
+
+        for (PointCloud& cloud : scene.clouds) {
+            cloud.stream();
         }
 
-        if (!selected_objects.empty()) {
+        upload_built_meshes();
+
+        profiler.begin_zone("bounds");
+        // pool by pool, the selection bit is read next to the object it belongs to; points come before the curves
+        // and polylines, so a moved point has marked its dependents dirty by the time their bounds are taken
+        scene.for_each_pool([&](auto& pool) {
+            for (size_t i = 0; i < pool.size(); ++i) {
+                auto& object = pool.items[i];
+                const ObjectRef ref{object.kind, pool.handle_of(i)};
+                const mat4 global_transform = pool.selection.test(i) ? relative_transform : mat4(1.0f);
+                const AABB previous = object.cached_bounds;
+
+                frame_objects.push_back(ref);
+                object_global_transforms.push_back(global_transform);
+                object_bounds.push_back(object.world_bounds(global_transform));
+
+                if (ref.kind == ObjectKind::Point && !(object_bounds.back() == previous)) {
+                    scene.point_moved(ref.handle);
+                }
+            }
+        });
+
+        scene_bvh.update(object_bounds);
+        profiler.end_zone();
+
+        profiler.begin_zone("culling");
+
+        // frustum culling: objects outside the view are neither updated nor drawn
+        const Frustum view_frustum = Frustum::from_box(view * projection, -1.0f, -1.0f, 1.0f, 1.0f);
+
+        object_visible.assign(frame_objects.size(), false);
+        scene_bvh.query_frustum(view_frustum, [&](unsigned int i) {
+            object_visible[i] = view_frustum.intersects(object_bounds[i]);
+        });
+
+        culled_objects = 0;
+
+        struct VisibleObject {
+            Object* object;
+            bool selected;
+            size_t frame_index;
+        };
+        auto visible_objects = frame_vector<VisibleObject>(frame_objects.size());
+
+        size_t frame_index = 0;
+        scene.for_each_pool([&](auto& pool) {
+            for (size_t i = 0; i < pool.size(); ++i, ++frame_index) {
+                auto& object = pool.items[i];
+
+                // bounds of curves do not include the selection transform their points are about to get
+                if (!object_visible[frame_index] && !object_bounds[frame_index].empty() && !object.follows_selection) {
+                    ++culled_objects;
+                    continue;
+                }
+
+                visible_objects.push_back({&object, pool.selection.test(i), frame_index});
+            }
+        });
+
+        profiler.end_zone();
+
+        // LOD selection and curve tessellation run on the job system, the GL uploads and the render queue, which
+        // reads the LOD each object picked, stay on this thread
+        profiler.begin_zone("prepare");
+        job_system.parallel_for(visible_objects.size(), updateGrain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                visible_objects[i].object->prepare(relative_transform, projection, view, width, height);
+            }
+        });
+        profiler.end_zone();
+
+        profiler.begin_zone("upload");
+        for (const VisibleObject& visible : visible_objects) {
+            visible.object->upload();
+            render_queue.push(visible.object, visible.selected, object_global_transforms[visible.frame_index]);
+        }
+        profiler.end_zone();
+
+        // end of "update"
+        profiler.end_zone();
+
+        profiler.begin_zone("picking");
+        hovered_object = {};
+        if (!ImGui::GetIO().WantCaptureMouse && !rightMousePressed && !middleMousePressed) {
+            double x, y;
+            glfwGetCursorPos(window, &x, &y);
+            hovered_object = pick_object(cursor_ray(x, y));
+        }
+        profiler.end_zone();
+
+        profiler.begin_zone("objects");
+        profiler.begin_gpu_pass("objects");
+        render_queue.sort();
+        render_queue.submit(projection, view);
+        profiler.end_gpu_pass();
+        profiler.end_zone();
+
+        profiler.begin_zone("picking");
+        if (pick.pending) {
+            request_pick();
+        }
+        profiler.end_zone();
+
+        if (scene.selection_count() > 0) {
             center_point->transform = Transform::identity();
             center_point->transform.s = vec3(0.5f, 0.5f, 0.5f);
 
             float counter = 0.0f;
 
-            for (auto& object : selected_objects) {
-                if (object->uid < 3) {
-                    center_point->transform.translation += object->transform.translation;
+            scene.for_each_selected([&](Object& object, ObjectRef ref) {
+                if (ref.kind == ObjectKind::Cursor || ref.kind == ObjectKind::Torus || ref.kind == ObjectKind::Point ||
+                    ref.kind == ObjectKind::PointCloud) {
+                    center_point->transform.translation += object.transform.translation;
                     counter++;
                 }
-            }
+            });
 
             if (counter > 0) {
                 center_point->transform.translation /= counter;
@@ -720,15 +1144,33 @@ int main() {
             }
         }
 
-        render_gui();
+        profiler.begin_zone("present");
+        profiler.begin_gpu_pass("present");
+        scene_framebuffer.end();
+        profiler.end_gpu_pass();
+        profiler.end_zone();
 
+        profiler.begin_zone("imgui");
+        render_gui();
         ImGui::Render();
+        profiler.begin_gpu_pass("imgui");
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler.end_gpu_pass();
+        profiler.end_zone();
+
+        stream_buffer.end_frame();
 
         glViewport(0, 0, width, height);
 
+        profiler.begin_zone("swap");
         glfwSwapBuffers(window);
+        profiler.end_zone();
+
+        profiler.begin_zone("input");
         glfwPollEvents();
+        profiler.end_zone();
+
+        profiler.end_frame();
 
         frameCount++;
         auto currentTime = std::chrono::high_resolution_clock::now();
@@ -740,6 +1182,16 @@ int main() {
         }
     }
 
+    job_system.stop();
+    mesh_builder.stop();
+    profiler.destroy();
+    scene.clear();
+    pick_readback.destroy();
+    scene_framebuffer.destroy();
+    mesh_arena.destroy();
+    stream_buffer.destroy();
+    camera_buffer.destroy();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <myglm.h>
+#include "utility/frame_arena.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+
+// The CPU side of every mesh the objects in geometry.h draw: plain functions of their parameters that build into
+// the frame arena and know nothing about GL, so they can be benchmarked and reused without a context. The objects
+// own the GPU side, the cad_geometry CMake target is this header and what it includes.
+
+using namespace myglm;
+
+using Vertex = vec3;
+using Triangle = u16vec3;
+using Edge = u16vec2;
+using Edge32 = u32vec2;
+
+// meshes keep 16-bit indices whenever every vertex is addressable with them
+constexpr size_t maxShortIndexVertices = 65536;
+
+constexpr bool fitsShortIndices(size_t vertex_count) {
+    return vertex_count <= maxShortIndexVertices;
+}
+
+inline bool same_position(const vec3& a, const vec3& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// torus
+
+// One vertex per (theta, phi) grid sample; the grid wraps in both directions, so the seam reuses the first row and
+// column instead of duplicating them. 256 x 256 samples still fit 16-bit indices.
+[[nodiscard]] inline FrameVector<Vertex> torus_vertices(
+    float big_radius, float small_radius, unsigned int theta_samples, unsigned int phi_samples
+) {
+    auto vertices = frame_vector<Vertex>(theta_samples * phi_samples);
+
+    for (unsigned int i = 0; i < theta_samples; ++i) {
+        const float theta = 2.0f * M_PIf * static_cast<float>(i) / static_cast<float>(theta_samples);
+        for (unsigned int j = 0; j < phi_samples; ++j) {
+            const float phi = 2.0f * M_PIf * static_cast<float>(j) / static_cast<float>(phi_samples);
+
+            float x = (big_radius + small_radius * cosf(phi)) * cosf(theta);
+            float y = (big_radius + small_radius * cosf(phi)) * sinf(theta);
+            float z = small_radius * sinf(phi);
+
+            vertices.emplace_back(x, y, z);
+        }
+    }
+    return vertices;
+}
+
+// every cell emits its three unique edges (i, j)-(i, j+1), (i, j+1)-(i+1, j), (i+1, j)-(i, j) with the indices
+// wrapped like the procedural vertex shader's, the remaining two sides belong to the neighbouring cells
+template <typename E = Edge>
+[[nodiscard]] FrameVector<E> torus_edges(unsigned int theta_samples, unsigned int phi_samples) {
+    auto edges = frame_vector<E>(theta_samples * phi_samples * 3);
+
+    for (unsigned int i = 0; i < theta_samples; ++i) {
+        const unsigned int next_i = (i + 1) % theta_samples;
+        for (unsigned int j = 0; j < phi_samples; ++j) {
+            const unsigned int next_j = (j + 1) % phi_samples;
+            unsigned int index1 = (i * phi_samples) + j;
+            unsigned int index2 = (i * phi_samples) + next_j;
+            unsigned int index3 = (next_i * phi_samples) + j;
+
+            edges.emplace_back(index1, index2);
+            edges.emplace_back(index2, index3);
+            edges.emplace_back(index3, index1);
+        }
+    }
+    return edges;
+}
+
+// sphere of a point, samples meridians by samples parallels
+
+[[nodiscard]] inline FrameVector<Vertex> sphere_vertices(float radius, unsigned int samples) {
+    auto vertices = frame_vector<Vertex>((samples + 1) * (samples + 1));
+
+    for (unsigned int i = 0; i <= samples; ++i) {
+        const float theta = 2.0f * M_PIf * static_cast<float>(i) / static_cast<float>(samples);
+        for (unsigned int j = 0; j <= samples; ++j) {
+            const float phi = M_PIf * static_cast<float>(j) / static_cast<float>(samples);
+
+            float x = radius * cosf(theta) * sinf(phi);
+            float y = radius * sinf(theta) * sinf(phi);
+            float z = radius * cosf(phi);
+
+            vertices.emplace_back(x, y, z);
+        }
+    }
+    return vertices;
+}
+
+template <typename E = Edge>
+[[nodiscard]] FrameVector<E> sphere_edges(unsigned int samples) {
+    auto edges = frame_vector<E>(samples * samples * 6);
+
+    for (unsigned int i = 0; i < samples; ++i) {
+        for (unsigned int j = 0; j < samples; ++j) {
+            unsigned int index1 = (i * (samples + 1)) + j;
+            unsigned int index2 = (i * (samples + 1)) + j + 1;
+            unsigned int index3 = ((i + 1) * (samples + 1)) + j;
+            unsigned int index4 = ((i + 1) * (samples + 1)) + j + 1;
+
+            edges.emplace_back(index1, index2);
+            edges.emplace_back(index2, index3);
+            edges.emplace_back(index3, index1);
+
+            edges.emplace_back(index2, index4);
+            edges.emplace_back(index4, index3);
+            edges.emplace_back(index3, index2);
+        }
+    }
+    return edges;
+}
+
+// polyline
+
+template <typename E = Edge>
+[[nodiscard]] FrameVector<E> polyline_edges(size_t vertex_count) {
+    auto edges = frame_vector<E>(vertex_count);
+
+    for (unsigned int i = 0; i + 1 < vertex_count; ++i) {
+        edges.emplace_back(i, i + 1);
+    }
+    return edges;
+}
+
+// cubic Bezier segments, adaptively subdivided in screen space
+
+// clip w below which a point counts as behind the camera
+constexpr float nearW = 1e-4f;
+constexpr unsigned int maxSubdivisionDepth = 12;
+
+// pixel coordinates of a world point, z keeps clip w so that points behind the camera can be detected
+[[nodiscard]] inline vec3 to_screen(const mat4& projection_view, const vec3& p, unsigned int width, unsigned int height) {
+    vec4 clip = mul(projection_view, vec4(p, 1.0f));
+    if (clip.w <= nearW) {
+        return vec3(0.0f, 0.0f, clip.w);
+    }
+    return vec3(
+        (clip.x / clip.w * 0.5f + 0.5f) * static_cast<float>(width),
+        (clip.y / clip.w * 0.5f + 0.5f) * static_cast<float>(height),
+        clip.w
+    );
+}
+
+// Wang's bound: uniform line segments needed to keep a cubic within tolerance pixels of its polyline
+[[nodiscard]] inline float calc_segment_density(const vec3* screen, float tolerance) {
+    unsigned int behind = 0;
+    for (unsigned int k = 0; k < 4; ++k) {
+        behind += screen[k].z <= nearW;
+    }
+    if (behind == 4) {
+        return 1.0f;
+    }
+    if (behind > 0) {
+        return static_cast<float>(1u << maxSubdivisionDepth);
+    }
+
+    auto second_difference = [&](unsigned int k) {
+        float x = screen[k].x - 2.0f * screen[k + 1].x + screen[k + 2].x;
+        float y = screen[k].y - 2.0f * screen[k + 1].y + screen[k + 2].y;
+        return std::sqrt(x * x + y * y);
+    };
+
+    float m = std::max(second_difference(0), second_difference(1));
+    return std::sqrt(0.75f * m / tolerance);
+}
+
+[[nodiscard]] inline unsigned int calc_subdivision_depth(float density) {
+    unsigned int segments = static_cast<unsigned int>(std::ceil(std::min(density, static_cast<float>(1u << maxSubdivisionDepth))));
+    return std::min(static_cast<unsigned int>(std::bit_width(std::max(segments, 1u) - 1)), maxSubdivisionDepth);
+}
+
+[[nodiscard]] inline bool is_flat(const vec3* screen, float tolerance) {
+    unsigned int behind = 0;
+    for (unsigned int k = 0; k < 4; ++k) {
+        behind += screen[k].z <= nearW;
+    }
+    if (behind > 0) {
+        // entirely behind the camera is never visible, partially behind has no meaningful projection
+        return behind == 4;
+    }
+
+    float dx = screen[3].x - screen[0].x;
+    float dy = screen[3].y - screen[0].y;
+    float chord = std::sqrt(dx * dx + dy * dy);
+
+    for (unsigned int k = 1; k < 3; ++k) {
+        float px = screen[k].x - screen[0].x;
+        float py = screen[k].y - screen[0].y;
+        float distance = chord > 1e-6f ? std::abs(px * dy - py * dx) / chord : std::sqrt(px * px + py * py);
+        if (distance > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// de Casteljau halving until the projected control polygon is flat, writes the end point of every piece
+inline void subdivide_segment(
+    const mat4& projection_view, unsigned int width, unsigned int height,
+    const vec3* p, float tolerance, unsigned int depth, vec3*& out
+) {
+    vec3 screen[4];
+    for (unsigned int k = 0; k < 4; ++k) {
+        screen[k] = to_screen(projection_view, p[k], width, height);
+    }
+
+    if (depth == 0 || is_flat(screen, tolerance)) {
+        *out++ = p[3];
+        return;
+    }
+
+    vec3 p01 = (p[0] + p[1]) * 0.5f;
+    vec3 p12 = (p[1] + p[2]) * 0.5f;
+    vec3 p23 = (p[2] + p[3]) * 0.5f;
+    vec3 p012 = (p01 + p12) * 0.5f;
+    vec3 p123 = (p12 + p23) * 0.5f;
+    vec3 p0123 = (p012 + p123) * 0.5f;
+
+    const vec3 left[4] = {p[0], p01, p012, p0123};
+    const vec3 right[4] = {p0123, p123, p23, p[3]};
+
+    subdivide_segment(projection_view, width, height, left, tolerance, depth - 1, out);
+    subdivide_segment(projection_view, width, height, right, tolerance, depth - 1, out);
+}
+
+// returns the number of vertices written, at most 2^depth + 1
+inline unsigned int calc_segment_vertices(
+    const mat4& projection_view, unsigned int width, unsigned int height,
+    const vec3* p, float tolerance, unsigned int depth, vec3* out
+) {
+    vec3* end = out;
+    *end++ = p[0];
+    subdivide_segment(projection_view, width, height, p, tolerance, depth, end);
+    return end - out;
+}
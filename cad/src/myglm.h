@@ -9,6 +9,11 @@ namespace myglm {
         unsigned short y;
     };
 
+    struct u32vec2 {
+        unsigned int x;
+        unsigned int y;
+    };
+
     struct u16vec3 {
         unsigned short x;
         unsigned short y;
@@ -186,7 +191,7 @@ namespace myglm {
         }
     };
 
-    mat4 translate(const mat4& m, const vec3& v) {
+    inline mat4 translate(const mat4& m, const vec3& v) {
         mat4 translationMatrix(1.0f);
 
         translationMatrix.elements[3][0] = v.x;
@@ -196,7 +201,7 @@ namespace myglm {
         return translationMatrix * m;
     }
 
-    mat4 scale(const mat4& m, const vec3& v) {
+    inline mat4 scale(const mat4& m, const vec3& v) {
         mat4 scaleMatrix(1.0f);
 
         scaleMatrix.elements[0][0] = v.x;
@@ -206,7 +211,7 @@ namespace myglm {
         return scaleMatrix * m;
     }
 
-    mat4 rotate(const mat4& m, float angle, const vec3& axis) {
+    inline mat4 rotate(const mat4& m, float angle, const vec3& axis) {
         float c = std::cos(angle);
         float s = std::sin(angle);
         float one_minus_c = 1.0f - c;
@@ -243,7 +248,7 @@ namespace myglm {
         return rotation * m;
     }
 
-    mat4 perspective(float fovy, float aspect, float near, float far) {
+    inline mat4 perspective(float fovy, float aspect, float near, float far) {
         mat4 result(0.0f);
 
         float tanHalfFovy = std::tan(fovy / 2.0f);
@@ -257,17 +262,17 @@ namespace myglm {
         return result;
     }
 
-    float dot(const vec3& a, const vec3& b) {
+    inline float dot(const vec3& a, const vec3& b) {
         return a.x * b.x + a.y * b.y + a.z * b.z;
     }
 
-    vec3 cross(const vec3& a, const vec3& b) {
+    inline vec3 cross(const vec3& a, const vec3& b) {
         return vec3(a.y * b.z - a.z * b.y,
                     a.z * b.x - a.x * b.z,
                     a.x * b.y - a.y * b.x);
     }
 
-    mat4 lookAt(const vec3& eye, const vec3& center, const vec3& up) {
+    inline mat4 lookAt(const vec3& eye, const vec3& center, const vec3& up) {
         vec3 f = (center - eye);
         float f_length = f.length();
         if (f_length < 1e-6f) {
@@ -306,7 +311,7 @@ namespace myglm {
         return result;
     }
 
-    quat quat_cast(const mat4& m) {
+    inline quat quat_cast(const mat4& m) {
         mat4 rotationMatrix = m;
         for (int i = 0; i < 3; ++i) {
             float rowMagnitude = std::sqrt(
@@ -355,7 +360,7 @@ namespace myglm {
         }
     }
 
-    vec3 eulerAngles(const quat& q) {
+    inline vec3 eulerAngles(const quat& q) {
         float norm = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
         quat nq = (norm > 0.0f) ? quat(q.w / norm, q.x / norm, q.y / norm, q.z / norm) : quat();
 
@@ -366,39 +371,39 @@ namespace myglm {
         return vec3(roll, pitch, yaw);
     }
 
-    float radians(float degrees) {
+    inline float radians(float degrees) {
         return degrees * (M_PI / 180.0f);
     }
 
-    float degrees(float radians) {
+    inline float degrees(float radians) {
         return radians * (180.0f / M_PI);
     }
 
-    float length(const vec3& v) {
+    inline float length(const vec3& v) {
         return v.length();
     }
 
-    float* value_ptr(mat4& m) {
+    inline float* value_ptr(mat4& m) {
         return &m.elements[0][0];
     }
 
-    float* value_ptr(vec3& v) {
+    inline float* value_ptr(vec3& v) {
         return &v.x;
     }
 
-    float* value_ptr(const mat4& m){
+    inline float* value_ptr(const mat4& m){
         return (float*)&m.elements[0][0];
     }
 
-    vec3 degrees(const vec3& v) {
+    inline vec3 degrees(const vec3& v) {
         return vec3(degrees(v.x), degrees(v.y), degrees(v.z));
     }
 
-    vec3 radians(const vec3& v) {
+    inline vec3 radians(const vec3& v) {
         return vec3(radians(v.x), radians(v.y), radians(v.z));
     }
 
-    mat4 transpose(const mat4& m) {
+    inline mat4 transpose(const mat4& m) {
         mat4 result;
         for (int i = 0; i < 4; ++i) {
             for (int j = 0; j < 4; ++j) {
@@ -408,11 +413,11 @@ namespace myglm {
         return result;
     }
 
-    vec3 normalize(const vec3& v) {
+    inline vec3 normalize(const vec3& v) {
         return v / v.length();
     }
 
-    mat4 rot_mat(const quat& q) {
+    inline mat4 rot_mat(const quat& q) {
         mat4 mat(1.0f);
 
         float xx = q.x * q.x;
@@ -440,7 +445,7 @@ namespace myglm {
         return mat;
     }
 
-    mat4 trans_mat(const vec3& translation_vector) {
+    inline mat4 trans_mat(const vec3& translation_vector) {
         mat4 mat(1.0f);
         mat[0][3] = translation_vector.x;
         mat[1][3] = translation_vector.y;
@@ -448,7 +453,7 @@ namespace myglm {
         return transpose(mat);
     }
 
-    mat4 scale_mat(const vec3& scale_vector) {
+    inline mat4 scale_mat(const vec3& scale_vector) {
         mat4 mat(1.0f);
         mat[0][0] = scale_vector.x;
         mat[1][1] = scale_vector.y;
@@ -456,7 +461,7 @@ namespace myglm {
         return transpose(mat);
     }
 
-    quat angleAxis(float angle, const vec3& axis) {
+    inline quat angleAxis(float angle, const vec3& axis) {
         vec3 normalized_axis = normalize(axis);
         float half_angle = angle * 0.5f;
         float s = sin(half_angle);
@@ -510,7 +515,7 @@ namespace myglm {
         }
     };
 
-    bool all_close(const mat4& a, const mat4& b, float rtol = 1e-5f, float atol = 1e-8f) {
+    inline bool all_close(const mat4& a, const mat4& b, float rtol = 1e-5f, float atol = 1e-8f) {
         for (int i = 0; i < 4; ++i) {
             for (int j = 0; j < 4; ++j) {
                 if (std::abs(a.elements[i][j] - b.elements[i][j]) > atol + rtol * std::abs(b.elements[i][j])) {
@@ -521,11 +526,11 @@ namespace myglm {
         return true;
     }
 
-    vec3 vec3_from_vec4(vec4 v) {
+    inline vec3 vec3_from_vec4(vec4 v) {
         return vec3(v.x, v.y, v.z);
     }
 
-    vec3 mul(const mat4& mat, const vec3& vec) {
+    inline vec3 mul(const mat4& mat, const vec3& vec) {
         vec3 result;
         result.x = mat.elements[0][0] * vec.x + mat.elements[1][0] * vec.y + mat.elements[2][0] * vec.z + mat.elements[3][0];
         result.y = mat.elements[0][1] * vec.x + mat.elements[1][1] * vec.y + mat.elements[2][1] * vec.z + mat.elements[3][1];
@@ -538,7 +543,7 @@ namespace myglm {
         return result;
     }
 
-    vec4 mul(const mat4& mat, const vec4& vec) {
+    inline vec4 mul(const mat4& mat, const vec4& vec) {
         vec4 result;
         result.x = mat.elements[0][0] * vec.x + mat.elements[1][0] * vec.y + mat.elements[2][0] * vec.z + mat.elements[3][0] * vec.w;
         result.y = mat.elements[0][1] * vec.x + mat.elements[1][1] * vec.y + mat.elements[2][1] * vec.z + mat.elements[3][1] * vec.w;
@@ -547,7 +552,7 @@ namespace myglm {
         return result;
     }
 
-    void print_mat4(const mat4& mat) {
+    inline void print_mat4(const mat4& mat) {
         std::cout << "Inverted Matrix:" << std::endl;
         for (int i = 0; i < 4; ++i) {
             for (int j = 0; j < 4; ++j) {
@@ -557,19 +562,19 @@ namespace myglm {
         }
     }
 
-    vec3 min(const vec3& a, const vec3& b) {
+    inline vec3 min(const vec3& a, const vec3& b) {
         return vec3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
     }
 
-    vec3 max(const vec3& a, const vec3& b) {
+    inline vec3 max(const vec3& a, const vec3& b) {
         return vec3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
     }
 
-    float max(float a, float b, float c) {
+    inline float max(float a, float b, float c) {
         return std::max(std::max(a, b), c);
     }
 
-    float min(float a, float b, float c) {
+    inline float min(float a, float b, float c) {
         return std::min(std::min(a, b), c);
     }
 
@@ -577,7 +582,7 @@ namespace myglm {
         return vec4(v.x, v.y, v.z, w);
     }
 
-    quat from_euler_angles(const vec3& euler_angles) {
+    inline quat from_euler_angles(const vec3& euler_angles) {
         quat quat_x = angleAxis(euler_angles.x, vec3(1, 0, 0));
         quat quat_y = angleAxis(euler_angles.y, vec3(0, 1, 0));
         quat quat_z = angleAxis(euler_angles.z, vec3(0, 0, 1));
@@ -652,7 +657,7 @@ namespace myglm {
         }
     };
 
-    mat3 transpose(const mat3& m) {
+    inline mat3 transpose(const mat3& m) {
         mat3 result;
         for (int i = 0; i < 3; ++i) {
             for (int j = 0; j < 3; ++j) {
@@ -662,13 +667,13 @@ namespace myglm {
         return result;
     }
 
-    float determinant(const mat3& m) {
+    inline float determinant(const mat3& m) {
         return m.elements[0][0] * (m.elements[1][1] * m.elements[2][2] - m.elements[1][2] * m.elements[2][1]) -
                m.elements[0][1] * (m.elements[1][0] * m.elements[2][2] - m.elements[1][2] * m.elements[2][0]) +
                m.elements[0][2] * (m.elements[1][0] * m.elements[2][1] - m.elements[1][1] * m.elements[2][0]);
     }
 
-    mat3 inverse(const mat3& m) {
+    inline mat3 inverse(const mat3& m) {
         float det = determinant(m);
         if (std::abs(det) < 1e-6f) {
             // Matrix is singular or nearly singular
@@ -693,7 +698,44 @@ namespace myglm {
         return result;
     }
 
-    void print_mat3(const mat3& mat) {
+    // general inverse by cofactor expansion
+    inline mat4 inverse(const mat4& m) {
+        const float* a = &m.elements[0][0];
+        float inv[16];
+
+        inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+        inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+        inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+        inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+        inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+        inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+        inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+        inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+        inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+        inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+        inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+        inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+        inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+        inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+        inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+        inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+        float det = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+        if (std::abs(det) < 1e-12f) {
+            // Matrix is singular or nearly singular
+            return mat4();
+        }
+
+        float invDet = 1.0f / det;
+
+        mat4 result;
+        for (int i = 0; i < 16; ++i) {
+            result.elements[i / 4][i % 4] = inv[i] * invDet;
+        }
+        return result;
+    }
+
+    inline void print_mat3(const mat3& mat) {
         std::cout << "3x3 Matrix:" << std::endl;
         for (int i = 0; i < 3; ++i) {
             for (int j = 0; j < 3; ++j) {
@@ -703,7 +745,7 @@ namespace myglm {
         }
     }
 
-    mat4 mat4_cast(const mat3& m) {
+    inline mat4 mat4_cast(const mat3& m) {
         mat4 result(1.0f);
         for (int i = 0; i < 3; ++i) {
             for (int j = 0; j < 3; ++j) {
@@ -713,15 +755,15 @@ namespace myglm {
         return result;
     }
 
-    float* value_ptr(mat3& m) {
+    inline float* value_ptr(mat3& m) {
         return &m.elements[0][0];
     }
 
-    float* value_ptr(const mat3& m) {
+    inline float* value_ptr(const mat3& m) {
         return (float*)&m.elements[0][0];
     }
 
-    vec3 bezierPoint(float t, const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3) {
+    inline vec3 bezierPoint(float t, const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3) {
         float t2 = t * t;
         float t3 = t * t2;
         float mt = 1.0f - t;
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <geometry.h>
+#include <point_cloud_loader.h>
+#include <point_octree.h>
+#include <memory>
+#include <mutex>
+
+// the octree of a cloud and the lock the loader's indexer takes to extend it, on the heap so the cloud can move
+// between pool slots while an import is running
+struct PointCloudData {
+    std::mutex mutex;
+    PointOctree octree;
+};
+
+// Scanned reference data: every sample is one vertex of a single position buffer drawn with GL_POINTS, instead
+// of a Point object with its own sphere. The buffer mirrors the pages of the cloud's octree, and each frame
+// prepare() picks the nodes to draw within point_budget, coarse samples for distant nodes and refined ones near
+// the camera, drawn with one glMultiDrawArrays.
+//
+// While an import runs, stream() uploads the points the indexer added since the last frame. The octree is in the
+// cloud's local space, so moving the cloud through the transform windows only changes its model matrix.
+struct PointCloud : Object {
+    static constexpr size_t pointSize = sizeof(vec3);
+    static constexpr size_t initialCapacity = 1 << 18;
+    // bytes streamed per frame, well inside a stream buffer region and short enough to hold the octree's lock for
+    static constexpr size_t uploadBudget = 4 << 20;
+    // nodes are refined until their samples are this close on screen
+    static constexpr float spacingPixels = 2.0f;
+
+    size_t point_count = 0;
+    size_t capacity = 0;
+    // this frame's share of the global point budget, see distribute_point_budget in main.cpp
+    size_t point_budget = 0;
+    size_t drawn_points = 0;
+    AABB local_bounds;
+    std::vector<int> draw_firsts;
+    std::vector<int> draw_counts;
+
+    // the loader's threads use data, so the loader is declared after it and destroyed first
+    std::unique_ptr<PointCloudData> data = std::make_unique<PointCloudData>();
+    std::unique_ptr<PointCloudLoader> loader;
+
+    PointCloud(const unsigned int shader, const std::string& name = "point cloud") {
+        this->transform = Transform::identity();
+        this->name = name;
+        this->shader = shader;
+        this->kind = ObjectKind::PointCloud;
+
+        glCreateVertexArrays(1, &VAO);
+        glEnableVertexArrayAttrib(VAO, 0);
+        glVertexArrayAttribFormat(VAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(VAO, 0, 0);
+
+        reserve(initialCapacity);
+    }
+
+    PointCloud(PointCloud&&) noexcept = default;
+
+    // swaps like Object's, so a running loader stays with the data it writes to
+    PointCloud& operator=(PointCloud&& other) noexcept {
+        Object::operator=(std::move(other));
+        std::swap(point_count, other.point_count);
+        std::swap(capacity, other.capacity);
+        std::swap(point_budget, other.point_budget);
+        std::swap(drawn_points, other.drawn_points);
+        std::swap(local_bounds, other.local_bounds);
+        std::swap(draw_firsts, other.draw_firsts);
+        std::swap(draw_counts, other.draw_counts);
+        std::swap(data, other.data);
+        std::swap(loader, other.loader);
+        return *this;
+    }
+
+    // starts importing an XYZ or PLY file in the background
+    bool load(const char* path) {
+        loader = std::make_unique<PointCloudLoader>();
+        if (!loader->start(path, data->octree, data->mutex)) {
+            loader.reset();
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool loading() const {
+        return loader != nullptr;
+    }
+
+    // called every frame, visible or not; uploads at most uploadBudget bytes of new points, the loader is dropped
+    // once every point is on the GPU
+    void stream() {
+        if (!loader) {
+            return;
+        }
+
+        // read before the flush, so that the points indexed last are flushed before the loader goes
+        const bool finished = loader->finished();
+        bool uploaded_all;
+        {
+            std::lock_guard lock(data->mutex);
+            PointOctree& octree = data->octree;
+
+            reserve(octree.page_count() * PointOctree::pageSize);
+            octree.flush(uploadBudget / pointSize, [&](size_t first, std::span<const vec3> points) {
+                stream_buffer.upload(VBO, first * pointSize, points.data(), points.size_bytes());
+            });
+            uploaded_all = octree.dirty_pages.empty();
+
+            if (octree.count != point_count) {
+                point_count = octree.count;
+                local_bounds = octree.bounds();
+                bounds_dirty = true;
+            }
+        }
+
+        if (finished && uploaded_all) {
+            loader.reset();
+        }
+    }
+
+    void reserve(size_t points) {
+        if (points <= capacity) {
+            return;
+        }
+        const size_t new_capacity = std::max(capacity * 2, points);
+        gl_state.forget_array_buffer(VBO);
+        VBO = MeshArena::resize_buffer(VBO, capacity * pointSize, new_capacity * pointSize);
+        capacity = new_capacity;
+        glVertexArrayVertexBuffer(VAO, 0, VBO, 0, pointSize);
+    }
+
+    void prepare(
+        const mat4& global_transform,
+        const mat4& projection,
+        const mat4& view,
+        unsigned int width,
+        unsigned int height
+    ) override {
+        const mat4 model = model_matrix(global_transform);
+        // the view frustum in the cloud's local space, where the octree is
+        const Frustum frustum = Frustum::from_box(model * view * projection, -1.0f, -1.0f, 1.0f, 1.0f);
+        const float scale = std::max({
+            length(vec3_from_vec4(mul(model, vec4(1.0f, 0.0f, 0.0f, 0.0f)))),
+            length(vec3_from_vec4(mul(model, vec4(0.0f, 1.0f, 0.0f, 0.0f)))),
+            length(vec3_from_vec4(mul(model, vec4(0.0f, 0.0f, 1.0f, 0.0f))))
+        });
+
+        auto projected = [&](const vec3& center, float radius) {
+            const vec3 world_center = vec3_from_vec4(mul(model, vec4(center, 1.0f)));
+            return projected_radius(world_center, radius * scale, projection, view, height);
+        };
+
+        std::lock_guard lock(data->mutex);
+        drawn_points = data->octree.select(frustum, projected, point_budget, spacingPixels, draw_firsts, draw_counts);
+    }
+
+    void draw(const mat4& projection, const mat4& view, bool selected, const mat4& global_transform) override {
+        if (draw_firsts.empty()) {
+            return;
+        }
+        use_shader(selected, global_transform);
+        gl_state.bind_vertex_array(VAO);
+        glMultiDrawArrays(GL_POINTS, draw_firsts.data(), draw_counts.data(), static_cast<int>(draw_firsts.size()));
+    }
+
+    [[nodiscard]] AABB bounds(const mat4& global_transform) const override {
+        return local_bounds.transformed(model_matrix(global_transform));
+    }
+
+    // box selection takes the whole cloud by its bounds; clicks only pick it through the GPU id buffer, a ray test
+    // against every sample would cost more than the frame
+    [[nodiscard]] bool intersects_frustum(const Frustum& frustum, const mat4& global_transform) const override {
+        return frustum.intersects(bounds(global_transform));
+    }
+};
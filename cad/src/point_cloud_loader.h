@@ -0,0 +1,517 @@
+#pragma once
+
+#include <point_octree.h>
+#include "utility/mapped_file.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Point clouds are read from ASCII XYZ files (one "x y z ..." line per point) and from PLY files, ASCII or
+// binary, of which only the x, y and z properties of the vertex element are used. The file is mapped and split
+// between worker threads that parse fixed-size chunks of positions; an indexer thread inserts the chunks into the
+// cloud's octree, from which the main thread uploads whatever was added each frame.
+
+enum class PlyType : uint8_t {
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64
+};
+
+constexpr unsigned int plyTypeSize(PlyType type) {
+    switch (type) {
+        case PlyType::Int8:
+        case PlyType::UInt8: return 1;
+        case PlyType::Int16:
+        case PlyType::UInt16: return 2;
+        case PlyType::Int32:
+        case PlyType::UInt32:
+        case PlyType::Float32: return 4;
+        case PlyType::Float64:
+        default: return 8;
+    }
+}
+
+// where the positions are in the file
+struct PointCloudLayout {
+    enum class Format {
+        Ascii,
+        BinaryLittleEndian,
+        BinaryBigEndian
+    };
+
+    Format format = Format::Ascii;
+    // byte range of the vertex data
+    size_t begin = 0;
+    size_t end = 0;
+    // number of vertices, 0 when the file does not say (XYZ)
+    size_t count = 0;
+    // ASCII: the columns of x, y and z; binary: their offsets and types within a vertex of stride bytes
+    std::array<unsigned int, 3> columns{0, 1, 2};
+    std::array<unsigned int, 3> offsets{};
+    std::array<PlyType, 3> types{};
+    size_t stride = 0;
+
+    // fails on anything but a PLY header with a fixed-size vertex element holding x, y and z
+    bool parse_ply(std::string_view text, std::string& error) {
+        struct Element {
+            std::string_view name;
+            size_t count;
+            size_t stride = 0;
+            unsigned int properties = 0;
+            bool has_list = false;
+            // column and byte offset of x, y and z, -1 until the property is declared
+            std::array<int, 3> column{-1, -1, -1};
+            std::array<unsigned int, 3> offset{};
+        };
+        std::vector<Element> elements;
+
+        auto fail = [&](const char* message) {
+            error = message;
+            return false;
+        };
+
+        size_t position = 0;
+        bool header_ended = false;
+        while (!header_ended && position < text.size()) {
+            size_t line_end = text.find('\n', position);
+            if (line_end == std::string_view::npos) {
+                return fail("unterminated header");
+            }
+
+            std::string_view line = text.substr(position, line_end - position);
+            position = line_end + 1;
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+
+            std::array<std::string_view, 5> words{};
+            const size_t word_count = split(line, words);
+            if (word_count == 0) {
+                continue;
+            }
+
+            if (words[0] == "format") {
+                if (words[1] == "ascii") {
+                    format = Format::Ascii;
+                } else if (words[1] == "binary_little_endian") {
+                    format = Format::BinaryLittleEndian;
+                } else if (words[1] == "binary_big_endian") {
+                    format = Format::BinaryBigEndian;
+                } else {
+                    return fail("unknown format");
+                }
+            } else if (words[0] == "element" && word_count >= 3) {
+                size_t element_count = 0;
+                std::from_chars(words[2].data(), words[2].data() + words[2].size(), element_count);
+                elements.push_back({words[1], element_count});
+            } else if (words[0] == "property" && !elements.empty()) {
+                Element& element = elements.back();
+                if (words[1] == "list") {
+                    element.has_list = true;
+                    ++element.properties;
+                    continue;
+                }
+
+                PlyType type;
+                if (word_count < 3 || !parse_type(words[1], type)) {
+                    return fail("unknown property type");
+                }
+
+                const std::string_view name = words[2];
+                const int axis = name == "x" ? 0 : name == "y" ? 1 : name == "z" ? 2 : -1;
+                if (axis >= 0 && element.name == "vertex") {
+                    element.column[axis] = static_cast<int>(element.properties);
+                    element.offset[axis] = static_cast<unsigned int>(element.stride);
+                    types[axis] = type;
+                }
+                element.stride += plyTypeSize(type);
+                ++element.properties;
+            } else if (words[0] == "end_header") {
+                header_ended = true;
+            }
+        }
+
+        if (!header_ended) {
+            return fail("missing end_header");
+        }
+
+        begin = position;
+        for (const Element& element : elements) {
+            if (element.name != "vertex") {
+                if (element.has_list) {
+                    return fail("elements with lists before the vertices are not supported");
+                }
+                if (format == Format::Ascii) {
+                    begin = skip_lines(text, begin, element.count);
+                } else {
+                    if (element.stride > 0 && element.count > (text.size() - begin) / element.stride) {
+                        return fail("file is shorter than its elements");
+                    }
+                    begin += element.count * element.stride;
+                }
+                continue;
+            }
+
+            if (element.has_list) {
+                return fail("vertices with list properties are not supported");
+            }
+            if (element.column[0] < 0 || element.column[1] < 0 || element.column[2] < 0) {
+                return fail("vertices without x, y and z");
+            }
+
+            count = element.count;
+            stride = element.stride;
+            for (unsigned int axis = 0; axis < 3; ++axis) {
+                columns[axis] = static_cast<unsigned int>(element.column[axis]);
+                offsets[axis] = element.offset[axis];
+            }
+
+            if (format == Format::Ascii) {
+                end = skip_lines(text, begin, count);
+            } else {
+                // compared by division, a hostile count would wrap count * stride around
+                if (count > (text.size() - begin) / stride) {
+                    return fail("file is shorter than its vertex data");
+                }
+                end = begin + count * stride;
+            }
+            return true;
+        }
+        return fail("no vertex element");
+    }
+
+    // splits on spaces, tabs and commas; returns the number of words, at most words.size() are stored
+    template <size_t N>
+    static size_t split(std::string_view line, std::array<std::string_view, N>& words) {
+        size_t count = 0;
+        size_t i = 0;
+        while (i < line.size()) {
+            while (i < line.size() && is_separator(line[i])) {
+                ++i;
+            }
+            const size_t start = i;
+            while (i < line.size() && !is_separator(line[i])) {
+                ++i;
+            }
+            if (i > start) {
+                if (count < N) {
+                    words[count] = line.substr(start, i - start);
+                }
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    static bool is_separator(char c) {
+        return c == ' ' || c == '\t' || c == ',' || c == '\r';
+    }
+
+private:
+    static bool parse_type(std::string_view name, PlyType& type) {
+        static constexpr std::pair<std::string_view, PlyType> names[] = {
+            {"char", PlyType::Int8}, {"int8", PlyType::Int8},
+            {"uchar", PlyType::UInt8}, {"uint8", PlyType::UInt8},
+            {"short", PlyType::Int16}, {"int16", PlyType::Int16},
+            {"ushort", PlyType::UInt16}, {"uint16", PlyType::UInt16},
+            {"int", PlyType::Int32}, {"int32", PlyType::Int32},
+            {"uint", PlyType::UInt32}, {"uint32", PlyType::UInt32},
+            {"float", PlyType::Float32}, {"float32", PlyType::Float32},
+            {"double", PlyType::Float64}, {"float64", PlyType::Float64},
+        };
+        for (const auto& [type_name, value] : names) {
+            if (type_name == name) {
+                type = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static size_t skip_lines(std::string_view text, size_t position, size_t lines) {
+        for (; lines > 0 && position < text.size(); --lines) {
+            const size_t line_end = text.find('\n', position);
+            position = line_end == std::string_view::npos ? text.size() : line_end + 1;
+        }
+        return position;
+    }
+};
+
+// positions parsed by one worker, with their bounds so the main thread does not have to visit them again
+struct PointCloudChunk {
+    std::vector<vec3> positions;
+    AABB bounds;
+};
+
+// Owns the mapping and the threads of one import. The workers parse disjoint parts of the file and queue their
+// chunks; once maxQueuedChunks are waiting they block until the indexer takes some, so a file that parses faster
+// than it is indexed does not end up in memory twice. The indexer holds the octree's mutex for indexBatch points at
+// a time, which bounds how long the main thread can wait for it. Destroying the loader cancels the import.
+struct PointCloudLoader {
+    static constexpr size_t chunkPoints = 1 << 16;
+    static constexpr size_t indexBatch = 1 << 12;
+    static constexpr size_t maxQueuedChunks = 32;
+    static constexpr unsigned int maxWorkers = 8;
+
+    MappedFile file;
+    PointCloudLayout layout;
+
+    std::vector<std::thread> workers;
+    std::thread indexer;
+    std::mutex mutex;
+    std::condition_variable space;
+    std::condition_variable available;
+    std::vector<PointCloudChunk> ready;
+    unsigned int running = 0;
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> indexed = false;
+
+    PointCloudLoader() = default;
+    PointCloudLoader(const PointCloudLoader&) = delete;
+    PointCloudLoader& operator=(const PointCloudLoader&) = delete;
+
+    ~PointCloudLoader() {
+        cancel();
+    }
+
+    // Maps the file, reads the PLY header if there is one and starts the threads that fill octree, which must not
+    // be touched without holding octree_mutex until the import has finished. Files that do not start with "ply"
+    // are read as XYZ.
+    bool start(const char* path, PointOctree& octree, std::mutex& octree_mutex) {
+        if (!file.open(path)) {
+            std::cerr << "Failed to open point cloud " << path << std::endl;
+            return false;
+        }
+
+        const std::string_view text(reinterpret_cast<const char*>(file.data), file.size);
+        if (text.starts_with("ply\n") || text.starts_with("ply\r\n")) {
+            std::string error;
+            if (!layout.parse_ply(text, error)) {
+                std::cerr << "Invalid PLY file " << path << ": " << error << std::endl;
+                return false;
+            }
+        } else {
+            layout.begin = 0;
+            layout.end = text.size();
+        }
+
+        const unsigned int worker_count = std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, maxWorkers);
+        running = worker_count;
+        workers.reserve(worker_count);
+        for (unsigned int i = 0; i < worker_count; ++i) {
+            workers.emplace_back([this, i, worker_count] { work(i, worker_count); });
+        }
+        indexer = std::thread([this, &octree, &octree_mutex] { index(octree, octree_mutex); });
+        return true;
+    }
+
+    // every point is in the octree
+    [[nodiscard]] bool finished() const {
+        return indexed;
+    }
+
+    void cancel() {
+        {
+            std::lock_guard lock(mutex);
+            cancelled = true;
+        }
+        space.notify_all();
+        available.notify_all();
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        if (indexer.joinable()) {
+            indexer.join();
+        }
+    }
+
+private:
+    // waits for the next chunk, false once the workers are done and the queue is empty or the import is cancelled
+    bool take(PointCloudChunk& chunk) {
+        {
+            std::unique_lock lock(mutex);
+            available.wait(lock, [&] { return !ready.empty() || running == 0 || cancelled; });
+            if (ready.empty() || cancelled) {
+                return false;
+            }
+            chunk = std::move(ready.back());
+            ready.pop_back();
+        }
+        space.notify_one();
+        return true;
+    }
+
+    void index(PointOctree& octree, std::mutex& octree_mutex) {
+        PointCloudChunk chunk;
+        while (take(chunk)) {
+            const std::span<const vec3> positions(chunk.positions);
+            for (size_t first = 0; first < positions.size() && !cancelled; first += indexBatch) {
+                std::lock_guard lock(octree_mutex);
+                octree.insert(positions.subspan(first, std::min(indexBatch, positions.size() - first)), chunk.bounds);
+            }
+        }
+        indexed = true;
+    }
+
+    void work(unsigned int worker, unsigned int worker_count) {
+        PointCloudChunk chunk;
+        chunk.positions.reserve(chunkPoints);
+
+        auto emit = [&](const vec3& position) {
+            // scanners write "nan" rows for missed returns, from_chars and binary floats both let them through
+            if (!is_finite(position)) {
+                return !cancelled.load(std::memory_order_relaxed);
+            }
+            chunk.positions.push_back(position);
+            chunk.bounds.expand(position);
+            if (chunk.positions.size() == chunkPoints) {
+                push(chunk);
+                chunk.positions.reserve(chunkPoints);
+            }
+            return !cancelled.load(std::memory_order_relaxed);
+        };
+
+        if (layout.format == PointCloudLayout::Format::Ascii) {
+            parse_lines(worker, worker_count, emit);
+        } else {
+            parse_binary(worker, worker_count, emit);
+        }
+
+        if (!chunk.positions.empty()) {
+            push(chunk);
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            --running;
+        }
+        available.notify_all();
+    }
+
+    void push(PointCloudChunk& chunk) {
+        {
+            std::unique_lock lock(mutex);
+            space.wait(lock, [&] { return ready.size() < maxQueuedChunks || cancelled; });
+            if (!cancelled) {
+                ready.push_back(std::move(chunk));
+            }
+        }
+        available.notify_one();
+        chunk = {};
+    }
+
+    // worker i takes the lines that start in its share of the bytes
+    template <typename Emit>
+    void parse_lines(unsigned int worker, unsigned int worker_count, Emit&& emit) const {
+        const char* text = reinterpret_cast<const char*>(file.data);
+        const size_t size = layout.end - layout.begin;
+
+        auto line_start = [&](size_t share) {
+            size_t position = layout.begin + size * share / worker_count;
+            // text shorter than worker_count bytes puts shares at the very beginning, which is a line start
+            if (share == 0 || share == worker_count || position == layout.begin) {
+                return position;
+            }
+            // a share that begins mid-line leaves that line to the previous worker
+            const void* newline = std::memchr(text + position - 1, '\n', layout.end - position + 1);
+            return newline ? static_cast<const char*>(newline) - text + 1 : layout.end;
+        };
+
+        const unsigned int last_column = std::max({layout.columns[0], layout.columns[1], layout.columns[2]});
+        std::array<std::string_view, 16> words{};
+        if (last_column >= words.size()) {
+            return;
+        }
+
+        size_t position = line_start(worker);
+        const size_t end = line_start(worker + 1);
+        while (position < end) {
+            const void* newline = std::memchr(text + position, '\n', end - position);
+            const size_t line_end = newline ? static_cast<const char*>(newline) - text : end;
+            const std::string_view line(text + position, line_end - position);
+            position = line_end + 1;
+
+            // comments, empty lines and column headers have no number where a coordinate should be
+            if (PointCloudLayout::split(line, words) <= last_column) {
+                continue;
+            }
+
+            float coordinates[3];
+            bool valid = true;
+            for (unsigned int axis = 0; axis < 3 && valid; ++axis) {
+                const std::string_view word = words[layout.columns[axis]];
+                valid = std::from_chars(word.data(), word.data() + word.size(), coordinates[axis]).ec == std::errc();
+            }
+
+            if (valid && !emit(vec3(coordinates))) {
+                return;
+            }
+        }
+    }
+
+    template <typename Emit>
+    void parse_binary(unsigned int worker, unsigned int worker_count, Emit&& emit) const {
+        const std::byte* vertices = file.data + layout.begin;
+        const size_t first = layout.count * worker / worker_count;
+        const size_t last = layout.count * (worker + 1) / worker_count;
+        const bool swap = (layout.format == PointCloudLayout::Format::BinaryBigEndian) !=
+                          (std::endian::native == std::endian::big);
+
+        for (size_t i = first; i < last; ++i) {
+            const std::byte* vertex = vertices + i * layout.stride;
+            const vec3 position(
+                read_scalar(vertex + layout.offsets[0], layout.types[0], swap),
+                read_scalar(vertex + layout.offsets[1], layout.types[1], swap),
+                read_scalar(vertex + layout.offsets[2], layout.types[2], swap)
+            );
+            if (!emit(position)) {
+                return;
+            }
+        }
+    }
+
+    static float read_scalar(const std::byte* data, PlyType type, bool swap) {
+        std::byte bytes[8];
+        const unsigned int size = plyTypeSize(type);
+        std::memcpy(bytes, data, size);
+        if (swap) {
+            std::reverse(bytes, bytes + size);
+        }
+
+        auto as = [&]<typename T>(T value) {
+            std::memcpy(&value, bytes, sizeof(T));
+            return static_cast<float>(value);
+        };
+
+        switch (type) {
+            case PlyType::Int8: return as(int8_t{});
+            case PlyType::UInt8: return as(uint8_t{});
+            case PlyType::Int16: return as(int16_t{});
+            case PlyType::UInt16: return as(uint16_t{});
+            case PlyType::Int32: return as(int32_t{});
+            case PlyType::UInt32: return as(uint32_t{});
+            case PlyType::Float32: return as(float{});
+            case PlyType::Float64:
+            default: return as(double{});
+        }
+    }
+};
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <intersection.h>
+#include "utility/frame_arena.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Level-of-detail octree over a point cloud, in the cloud's local space.
+//
+// Every node keeps a sample of the points inside its cube: a point stays in the first node on its way down whose
+// gridResolution^3 sampling grid has no point in its cell yet, so a node's points cover its cube evenly at a spacing
+// of size / gridResolution whatever order they arrive in, and the rest go on to the children. Drawing a node and
+// its ancestors therefore gives a uniformly thinned-out picture of its cube, and refining means adding children.
+// Nodes at minimum size keep everything that reaches them.
+//
+// Points are stored in pages of pageSize, in the order the pages are handed out, which is the order the GPU
+// buffer mirrors; a node owns a list of pages. The tree is built incrementally as chunks arrive: the root grows
+// outwards when a point falls outside it and the tight bounds of every node on a point's path are refit.
+struct PointOctree {
+    static constexpr unsigned int gridResolution = 16;
+    static constexpr unsigned int gridCells = gridResolution * gridResolution * gridResolution;
+    static constexpr unsigned int pageSize = 128;
+    // depth below the first root at which nodes stop splitting
+    static constexpr unsigned int maxDepth = 12;
+    static constexpr uint32_t none = ~0u;
+
+    struct Node {
+        vec3 min;
+        float size;
+        // tight bounds of the points in this node and its descendants
+        AABB bounds;
+        std::array<uint32_t, 8> children;
+        std::vector<uint32_t> pages;
+        uint32_t count = 0;
+        // one bit per cell of the sampling grid, empty for nodes at minimum size
+        std::vector<uint64_t> occupied;
+    };
+
+    std::vector<Node> nodes;
+    uint32_t root = none;
+    float min_size = 0.0f;
+    size_t count = 0;
+
+    std::vector<vec3> points;
+    std::vector<uint32_t> page_fill;
+    // pages with points that were not uploaded yet, and how many of each page were
+    std::vector<uint32_t> dirty_pages;
+    std::vector<uint32_t> page_uploaded;
+
+    [[nodiscard]] AABB bounds() const {
+        return root == none ? AABB{} : nodes[root].bounds;
+    }
+
+    // bounds is the chunk's, it sizes the first root
+    void insert(std::span<const vec3> chunk, const AABB& bounds) {
+        if (chunk.empty()) {
+            return;
+        }
+
+        if (root == none) {
+            const vec3 extent = bounds.max - bounds.min;
+            const float size = std::max({extent.x, extent.y, extent.z, 1e-3f}) * 1.001f;
+            root = add_node(bounds.min, size);
+            min_size = size / static_cast<float>(1u << maxDepth);
+        }
+
+        for (const vec3& p : chunk) {
+            insert(p);
+        }
+    }
+
+    // Picks the nodes to draw, nearest on screen first, until budget points are taken. Children are only visited
+    // while the parent's sample spacing is over spacing_pixels on screen. projected(center, radius) gives the
+    // on-screen radius in pixels of a local-space sphere; the frustum is in local space too. Emits first/count
+    // ranges of the buffer, merged where they touch, covering only points that were flushed; returns the number of
+    // points selected.
+    template <typename Projected>
+    size_t select(
+        const Frustum& frustum, Projected&& projected, size_t budget, float spacing_pixels,
+        std::vector<int>& firsts, std::vector<int>& counts
+    ) const {
+        firsts.clear();
+        counts.clear();
+        if (root == none) {
+            return 0;
+        }
+
+        struct Candidate {
+            float pixels;
+            uint32_t node;
+
+            bool operator<(const Candidate& other) const {
+                return pixels < other.pixels;
+            }
+        };
+
+        auto candidates = frame_vector<Candidate>(64);
+        auto consider = [&](uint32_t index) {
+            const Node& node = nodes[index];
+            if (!frustum.intersects(node.bounds)) {
+                return;
+            }
+            const vec3 half = (node.bounds.max - node.bounds.min) * 0.5f;
+            candidates.push_back({projected(node.bounds.center(), length(half)), index});
+            std::push_heap(candidates.begin(), candidates.end());
+        };
+
+        consider(root);
+
+        size_t selected = 0;
+        while (!candidates.empty()) {
+            std::pop_heap(candidates.begin(), candidates.end());
+            const Candidate candidate = candidates.back();
+            candidates.pop_back();
+
+            const Node& node = nodes[candidate.node];
+            if (selected + node.count > budget) {
+                break;
+            }
+            selected += node.count;
+
+            for (uint32_t page : node.pages) {
+                const int first = static_cast<int>(static_cast<size_t>(page) * pageSize);
+                const int page_count = static_cast<int>(page_uploaded[page]);
+                if (page_count == 0) {
+                    continue;
+                }
+                if (!firsts.empty() && firsts.back() + counts.back() == first) {
+                    counts.back() += page_count;
+                } else {
+                    firsts.push_back(first);
+                    counts.push_back(page_count);
+                }
+            }
+
+            // the on-screen radius covers the node's whole cube, its spacing is a grid cell of it
+            const float spacing = candidate.pixels * 2.0f / static_cast<float>(gridResolution);
+            if (spacing <= spacing_pixels) {
+                continue;
+            }
+            for (uint32_t child : node.children) {
+                if (child != none) {
+                    consider(child);
+                }
+            }
+        }
+        return selected;
+    }
+
+    // Calls upload(first_point, points) for at most max_points of the points added since the last call, lowest
+    // pages first; what does not fit stays dirty for the next call. Runs of consecutive pages go in one range,
+    // including the unused tails of the pages in between, which nothing draws but which count against the budget.
+    template <typename Upload>
+    void flush(size_t max_points, Upload&& upload) {
+        std::sort(dirty_pages.begin(), dirty_pages.end());
+
+        size_t i = 0;
+        size_t budget = max_points;
+        while (i < dirty_pages.size() && budget > 0) {
+            const uint32_t first_page = dirty_pages[i];
+            const size_t begin = static_cast<size_t>(first_page) * pageSize + page_uploaded[first_page];
+            const size_t limit = begin + budget;
+            size_t end = begin;
+
+            for (uint32_t page = first_page;;) {
+                const size_t page_begin = static_cast<size_t>(page) * pageSize;
+                // a later page of the run may have been uploaded up to past the budget already
+                if (page_begin + page_uploaded[page] >= limit) {
+                    break;
+                }
+                end = std::min(page_begin + page_fill[page], limit);
+                page_uploaded[page] = end - page_begin;
+                // the budget ended inside the page, which stays dirty
+                if (page_uploaded[page] < page_fill[page]) {
+                    break;
+                }
+                if (++i == dirty_pages.size() || dirty_pages[i] != page + 1) {
+                    break;
+                }
+                page = dirty_pages[i];
+            }
+
+            upload(begin, std::span<const vec3>(points).subspan(begin, end - begin));
+            budget -= end - begin;
+        }
+        dirty_pages.erase(dirty_pages.begin(), dirty_pages.begin() + i);
+    }
+
+    [[nodiscard]] size_t page_count() const {
+        return page_fill.size();
+    }
+
+private:
+    uint32_t add_node(const vec3& min, float size) {
+        Node node;
+        node.min = min;
+        node.size = size;
+        node.children.fill(none);
+        if (size > min_size) {
+            node.occupied.assign(gridCells / 64, 0);
+        }
+        nodes.push_back(std::move(node));
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    [[nodiscard]] bool contains(const Node& node, const vec3& p) const {
+        return p.x >= node.min.x && p.y >= node.min.y && p.z >= node.min.z &&
+               p.x <= node.min.x + node.size && p.y <= node.min.y + node.size && p.z <= node.min.z + node.size;
+    }
+
+    // doubles the root towards p, the old root becomes one of the new root's children
+    void grow(const vec3& p) {
+        const Node& old = nodes[root];
+        const float size = old.size;
+        const bool below[3] = {p.x < old.min.x, p.y < old.min.y, p.z < old.min.z};
+
+        const vec3 min(
+            below[0] ? old.min.x - size : old.min.x,
+            below[1] ? old.min.y - size : old.min.y,
+            below[2] ? old.min.z - size : old.min.z
+        );
+        const unsigned int octant = (below[0] ? 1 : 0) | (below[1] ? 2 : 0) | (below[2] ? 4 : 0);
+        const AABB bounds = old.bounds;
+        const uint32_t old_root = root;
+
+        root = add_node(min, size * 2.0f);
+        nodes[root].children[octant] = old_root;
+        nodes[root].bounds = bounds;
+    }
+
+    // p must be finite, the root would grow towards a NaN or infinity forever
+    void insert(const vec3& p) {
+        assert(is_finite(p));
+        while (!contains(nodes[root], p)) {
+            grow(p);
+        }
+
+        uint32_t index = root;
+        while (true) {
+            Node& node = nodes[index];
+            node.bounds.expand(p);
+
+            if (node.occupied.empty()) {
+                append(index, p);
+                return;
+            }
+
+            const float cell_size = node.size / static_cast<float>(gridResolution);
+            auto cell_of = [&](float value, float min) {
+                const int cell = static_cast<int>((value - min) / cell_size);
+                return static_cast<unsigned int>(std::clamp(cell, 0, static_cast<int>(gridResolution) - 1));
+            };
+            const unsigned int cx = cell_of(p.x, node.min.x);
+            const unsigned int cy = cell_of(p.y, node.min.y);
+            const unsigned int cz = cell_of(p.z, node.min.z);
+            const unsigned int cell = (cz * gridResolution + cy) * gridResolution + cx;
+
+            uint64_t& word = node.occupied[cell / 64];
+            const uint64_t bit = uint64_t{1} << (cell % 64);
+            if ((word & bit) == 0) {
+                word |= bit;
+                append(index, p);
+                return;
+            }
+
+            constexpr unsigned int half = gridResolution / 2;
+            const unsigned int octant = (cx >= half ? 1 : 0) | (cy >= half ? 2 : 0) | (cz >= half ? 4 : 0);
+            if (node.children[octant] == none) {
+                const float child_size = node.size * 0.5f;
+                const vec3 child_min(
+                    node.min.x + (octant & 1 ? child_size : 0.0f),
+                    node.min.y + (octant & 2 ? child_size : 0.0f),
+                    node.min.z + (octant & 4 ? child_size : 0.0f)
+                );
+                // add_node may reallocate nodes, node is not used past this point
+                const uint32_t child = add_node(child_min, child_size);
+                nodes[index].children[octant] = child;
+            }
+            index = nodes[index].children[octant];
+        }
+    }
+
+    void append(uint32_t index, const vec3& p) {
+        Node& node = nodes[index];
+        if (node.pages.empty() || page_fill[node.pages.back()] == pageSize) {
+            node.pages.push_back(static_cast<uint32_t>(page_fill.size()));
+            page_fill.push_back(0);
+            page_uploaded.push_back(0);
+            points.resize(points.size() + pageSize);
+        }
+
+        const uint32_t page = node.pages.back();
+        if (page_fill[page] == page_uploaded[page]) {
+            dirty_pages.push_back(page);
+        }
+        points[static_cast<size_t>(page) * pageSize + page_fill[page]++] = p;
+        ++node.count;
+        ++count;
+    }
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+#include <geometry.h>
+
+struct DrawItem {
+    Object* object;
+    unsigned int program;
+    unsigned int vertex_array;
+    unsigned int index_type;
+    unsigned int order;
+    bool selected;
+    mat4 global_transform;
+};
+
+// layout of glMultiDrawElementsIndirect commands
+struct DrawElementsIndirectCommand {
+    unsigned int count;
+    unsigned int instance_count;
+    unsigned int first_index;
+    int base_vertex;
+    unsigned int base_instance;
+};
+
+// std430 element of the Objects buffer in the batched shaders
+struct ObjectData {
+    mat4 model;
+    unsigned int flags;
+    unsigned int pick_id;
+    unsigned int padding[2];
+};
+
+constexpr unsigned int objectDataBinding = 0;
+constexpr unsigned int objectSelectedFlag = 1;
+
+// Collects the frame's draws and submits them grouped by program and vertex array, so that
+// consecutive draws share as much GL state as possible. Bindings go through gl_state, which drops the redundant ones.
+// Arena meshes sharing a program and index type are merged into one glMultiDrawElementsIndirect, with commands and
+// per-object data written to the stream buffer.
+struct RenderQueue {
+    std::vector<DrawItem> items;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<ObjectData> object_data;
+    unsigned int batches = 0;
+    unsigned int batched_draws = 0;
+
+    void clear() {
+        items.clear();
+        batches = 0;
+        batched_draws = 0;
+    }
+
+    void push(Object* object, bool selected, const mat4& global_transform) {
+        items.push_back({
+            object,
+            object->shader,
+            object->vertex_array(),
+            object->in_arena ? object->index_type : 0u,
+            static_cast<unsigned int>(items.size()),
+            selected,
+            global_transform
+        });
+    }
+
+    void sort() {
+        std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) {
+            return std::tie(a.program, a.vertex_array, a.index_type, a.order) <
+                   std::tie(b.program, b.vertex_array, b.index_type, b.order);
+        });
+    }
+
+    void submit(const mat4& projection, const mat4& view) {
+        for (size_t i = 0; i < items.size();) {
+            size_t end = i + 1;
+
+            if (items[i].object->in_arena) {
+                while (end < items.size() && items[end].object->in_arena &&
+                       items[end].program == items[i].program && items[end].index_type == items[i].index_type) {
+                    ++end;
+                }
+            }
+
+            if (end - i > 1 && submit_batch(i, end)) {
+                i = end;
+                continue;
+            }
+
+            for (; i < end; ++i) {
+                auto& item = items[i];
+                item.object->draw(projection, view, item.selected, item.global_transform);
+            }
+        }
+    }
+
+private:
+    static size_t storage_alignment() {
+        static size_t alignment = [] {
+            int value = 0;
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &value);
+            return static_cast<size_t>(std::max(value, 16));
+        }();
+        return alignment;
+    }
+
+    // false when the stream buffer is out of space for this frame, the caller then draws the items one by one
+    bool submit_batch(size_t begin, size_t end) {
+        commands.clear();
+        object_data.clear();
+
+        for (size_t i = begin; i < end; ++i) {
+            const DrawItem& item = items[i];
+            const MeshAllocation& mesh = item.object->mesh;
+
+            commands.push_back({
+                static_cast<unsigned int>(mesh.index_count),
+                1,
+                static_cast<unsigned int>(mesh.first_index()),
+                static_cast<int>(mesh.first_vertex),
+                0
+            });
+            object_data.push_back({
+                item.object->transform.to_mat4() * item.global_transform,
+                item.selected ? objectSelectedFlag : 0u,
+                item.object->pick_id,
+                {}
+            });
+        }
+
+        const size_t commands_size = commands.size() * sizeof(DrawElementsIndirectCommand);
+        const size_t object_data_size = object_data.size() * sizeof(ObjectData);
+
+        size_t commands_offset;
+        size_t object_data_offset;
+        unsigned char* commands_memory = stream_buffer.allocate(commands_size, commands_offset);
+        if (commands_memory == nullptr) {
+            return false;
+        }
+        unsigned char* object_data_memory = stream_buffer.allocate(object_data_size, object_data_offset, storage_alignment());
+        if (object_data_memory == nullptr) {
+            return false;
+        }
+
+        std::memcpy(commands_memory, commands.data(), commands_size);
+        std::memcpy(object_data_memory, object_data.data(), object_data_size);
+
+        const DrawItem& first = items[begin];
+
+        gl_state.use_program(first.program);
+        // uniforms persist in the program, a procedural torus drawn earlier may have left u_procedural set
+        const UniformLocations& uniforms = ShaderManager::uniforms(first.program);
+        glUniform1i(uniforms.batched, true);
+        glUniform1i(uniforms.procedural, false);
+
+        gl_state.bind_vertex_array(first.vertex_array);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream_buffer.buffer);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, objectDataBinding, stream_buffer.buffer, object_data_offset, object_data_size);
+
+        glMultiDrawElementsIndirect(
+            GL_LINES, first.index_type, (void*)commands_offset, static_cast<int>(commands.size()), 0
+        );
+
+        ++batches;
+        batched_draws += static_cast<unsigned int>(commands.size());
+        return true;
+    }
+};
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <geometry.h>
+#include <point_cloud.h>
+#include "utility/pool.h"
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+// An object of the scene, named by its kind and its handle in that kind's pool.
+struct ObjectRef {
+    ObjectKind kind = ObjectKind::Cursor;
+    Handle handle;
+
+    [[nodiscard]] bool valid() const {
+        return handle.valid();
+    }
+
+    bool operator==(const ObjectRef&) const = default;
+};
+
+// programs the scene loaders create objects with
+struct SceneShaders {
+    unsigned int cursor;
+    unsigned int torus;
+    unsigned int point;
+    unsigned int bezier;
+    bool gpu_tessellation;
+};
+
+// The curves and polylines that use each point, indexed by the point's slot. Removing or moving a point visits
+// only its real dependents instead of every curve in the scene.
+struct DependencyIndex {
+    std::vector<std::vector<ObjectRef>> dependents;
+
+    [[nodiscard]] const std::vector<ObjectRef>& of(Handle point) const {
+        static const std::vector<ObjectRef> none;
+        return point.index < dependents.size() ? dependents[point.index] : none;
+    }
+
+    // a point used several times by one curve is linked once
+    void link(Handle point, ObjectRef dependent) {
+        if (point.index >= dependents.size()) {
+            dependents.resize(point.index + 1);
+        }
+        auto& list = dependents[point.index];
+        if (std::find(list.begin(), list.end(), dependent) == list.end()) {
+            list.push_back(dependent);
+        }
+    }
+
+    void unlink(Handle point, ObjectRef dependent) {
+        if (point.index < dependents.size()) {
+            std::erase(dependents[point.index], dependent);
+        }
+    }
+
+    void clear(Handle point) {
+        if (point.index < dependents.size()) {
+            dependents[point.index].clear();
+        }
+    }
+};
+
+// Objects are stored by value in one pool per type, so a pass over one type walks a contiguous array and knows
+// the concrete type without a cast. Selection lives in each pool's bitset. order keeps the insertion order the
+// objects list shows; everything else iterates pool by pool.
+struct Scene {
+    Pool<Cursor> cursors;
+    Pool<Torus> tori;
+    Pool<Point> points;
+    Pool<PolyLine> polylines;
+    Pool<C0Bezier> curves;
+    Pool<PointCloud> clouds;
+
+    std::vector<ObjectRef> order;
+
+    DependencyIndex dependencies;
+    // objects whose follows_selection was set last frame, so it can be reset without a pass over every curve
+    std::vector<ObjectRef> following;
+
+    template <typename T>
+    Pool<T>& pool() {
+        if constexpr (std::is_same_v<T, Cursor>) {
+            return cursors;
+        } else if constexpr (std::is_same_v<T, Torus>) {
+            return tori;
+        } else if constexpr (std::is_same_v<T, Point>) {
+            return points;
+        } else if constexpr (std::is_same_v<T, PolyLine>) {
+            return polylines;
+        } else if constexpr (std::is_same_v<T, C0Bezier>) {
+            return curves;
+        } else {
+            static_assert(std::is_same_v<T, PointCloud>);
+            return clouds;
+        }
+    }
+
+    // calls f with the pool that holds objects of the given kind
+    template <typename Self, typename F>
+    static decltype(auto) visit_pool(Self& self, ObjectKind kind, F&& f) {
+        switch (kind) {
+            case ObjectKind::Torus:
+                return f(self.tori);
+            case ObjectKind::Point:
+                return f(self.points);
+            case ObjectKind::PolyLine:
+                return f(self.polylines);
+            case ObjectKind::Bezier:
+                return f(self.curves);
+            case ObjectKind::PointCloud:
+                return f(self.clouds);
+            case ObjectKind::Cursor:
+            default:
+                return f(self.cursors);
+        }
+    }
+
+    // the scene's 3D cursor, always the first object added
+    Cursor& cursor() {
+        return cursors.items.front();
+    }
+
+    template <typename T>
+    ObjectRef add(T object) {
+        const ObjectKind kind = object.kind;
+        const ObjectRef ref{kind, pool<T>().insert(std::move(object))};
+        order.push_back(ref);
+
+        if (const std::vector<Handle>* points = used_points(ref)) {
+            for (Handle point : *points) {
+                dependencies.link(point, ref);
+            }
+        }
+        return ref;
+    }
+
+    // the points a curve or polyline is built from, null for other objects
+    const std::vector<Handle>* used_points(ObjectRef ref) const {
+        if (ref.kind == ObjectKind::Bezier) {
+            const C0Bezier* curve = curves.get(ref.handle);
+            return curve ? &curve->control_points : nullptr;
+        }
+        if (ref.kind == ObjectKind::PolyLine) {
+            const PolyLine* polyline = polylines.get(ref.handle);
+            return polyline ? &polyline->points : nullptr;
+        }
+        return nullptr;
+    }
+
+    void add_control_point(Handle curve_handle, Handle point) {
+        C0Bezier* curve = curves.get(curve_handle);
+        if (!curve || !points.contains(point)) {
+            return;
+        }
+        curve->control_points.push_back(point);
+        curve->control_polygon->points.push_back(point);
+        curve->bounds_dirty = true;
+        dependencies.link(point, {ObjectKind::Bezier, curve_handle});
+    }
+
+    // called after a point's world bounds changed, the cached bounds of its dependents are stale
+    void point_moved(Handle point) {
+        for (ObjectRef dependent : dependencies.of(point)) {
+            if (Object* object = get(dependent)) {
+                object->bounds_dirty = true;
+            }
+        }
+    }
+
+    // sets follows_selection on the dependents of the selected points and clears it on last frame's set
+    void update_following() {
+        for (ObjectRef ref : following) {
+            if (Object* object = get(ref)) {
+                object->follows_selection = false;
+            }
+        }
+        following.clear();
+
+        points.selection.for_each([&](size_t i) {
+            for (ObjectRef dependent : dependencies.of(points.handle_of(i))) {
+                Object* object = get(dependent);
+                if (object && !object->follows_selection) {
+                    object->follows_selection = true;
+                    following.push_back(dependent);
+                }
+            }
+        });
+    }
+
+    Object* get(ObjectRef ref) {
+        return visit_pool(*this, ref.kind, [&](auto& pool) -> Object* { return pool.get(ref.handle); });
+    }
+
+    const Object* get(ObjectRef ref) const {
+        return visit_pool(*this, ref.kind, [&](auto& pool) -> const Object* { return pool.get(ref.handle); });
+    }
+
+    // points are also dropped from the curves and polylines that use them
+    void remove(ObjectRef ref) {
+        if (ref.kind == ObjectKind::Point) {
+            for (ObjectRef dependent : dependencies.of(ref.handle)) {
+                detach_point(dependent, ref.handle);
+            }
+            dependencies.clear(ref.handle);
+        } else if (const std::vector<Handle>* points = used_points(ref)) {
+            for (Handle point : *points) {
+                dependencies.unlink(point, ref);
+            }
+        }
+
+        visit_pool(*this, ref.kind, [&](auto& pool) { pool.remove(ref.handle); });
+        std::erase(order, ref);
+    }
+
+    // visit(object, ref) for every object, pool by pool
+    template <typename F>
+    void for_each(F&& visit) {
+        for_each_pool([&](auto& pool) {
+            for (size_t i = 0; i < pool.size(); ++i) {
+                visit(pool.items[i], ObjectRef{pool.items[i].kind, pool.handle_of(i)});
+            }
+        });
+    }
+
+    template <typename F>
+    void for_each_selected(F&& visit) {
+        for_each_pool([&](auto& pool) {
+            pool.selection.for_each([&](size_t i) {
+                visit(pool.items[i], ObjectRef{pool.items[i].kind, pool.handle_of(i)});
+            });
+        });
+    }
+
+    [[nodiscard]] bool selected(ObjectRef ref) const {
+        return visit_pool(*this, ref.kind, [&](auto& pool) { return pool.selected(ref.handle); });
+    }
+
+    void set_selected(ObjectRef ref, bool value = true) {
+        visit_pool(*this, ref.kind, [&](auto& pool) { pool.set_selected(ref.handle, value); });
+    }
+
+    void clear_selection() {
+        for_each_pool([](auto& pool) { pool.selection.clear(); });
+    }
+
+    [[nodiscard]] size_t selection_count() const {
+        return cursors.selection.count + tori.selection.count + points.selection.count +
+            polylines.selection.count + curves.selection.count + clouds.selection.count;
+    }
+
+    // any selected object, for the menus that edit a single selection
+    ObjectRef first_selected() {
+        ObjectRef first;
+        for_each_selected([&](Object&, ObjectRef ref) {
+            if (!first.valid()) {
+                first = ref;
+            }
+        });
+        return first;
+    }
+
+    // destroys every object, while the GL context and the mesh arena are still alive
+    void clear() {
+        for_each_pool([](auto& pool) { pool.clear(); });
+        order.clear();
+        dependencies = {};
+        following.clear();
+    }
+
+    [[nodiscard]] size_t size() const {
+        return order.size();
+    }
+
+    template <typename F>
+    void for_each_pool(F&& f) {
+        f(cursors);
+        f(tori);
+        f(points);
+        f(polylines);
+        f(curves);
+        f(clouds);
+    }
+
+    void detach_point(ObjectRef dependent, Handle point) {
+        if (C0Bezier* curve = dependent.kind == ObjectKind::Bezier ? curves.get(dependent.handle) : nullptr) {
+            std::erase(curve->control_points, point);
+            std::erase(curve->control_polygon->points, point);
+            curve->bounds_dirty = true;
+        } else if (PolyLine* polyline = dependent.kind == ObjectKind::PolyLine ? polylines.get(dependent.handle) : nullptr) {
+            std::erase(polyline->points, point);
+            polyline->bounds_dirty = true;
+        }
+    }
+};
+
+inline Scene scene;
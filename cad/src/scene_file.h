@@ -0,0 +1,155 @@
+#pragma once
+
+#include <scene.h>
+#include <scene_format.h>
+#include "utility/mapped_file.h"
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+// Conversion between a scene and the arrays of scene_format.h, and loading and saving the binary format.
+
+inline TransformRecord SceneArrays::transform_record(const Transform& t) {
+    return {
+        {t.translation.x, t.translation.y, t.translation.z},
+        {t.rotation.x, t.rotation.y, t.rotation.z},
+        {t.s.x, t.s.y, t.s.z}
+    };
+}
+
+inline SceneArrays SceneArrays::from(const Scene& scene) {
+    SceneArrays arrays;
+
+    // a point's index in the arrays is its position in the pool
+    auto add_points = [&](const std::vector<Handle>& handles) {
+        const uint32_t first = arrays.point_indices.size();
+        for (Handle handle : handles) {
+            if (scene.points.contains(handle)) {
+                arrays.point_indices.push_back(scene.points.slots[handle.index].dense);
+            }
+        }
+        return RangeRecord{first, static_cast<uint32_t>(arrays.point_indices.size() - first)};
+    };
+
+    arrays.point_positions.reserve(scene.points.size());
+    for (const Point& point : scene.points) {
+        arrays.point_positions.push_back(point.transform.translation);
+        arrays.add_name(point.name);
+    }
+
+    for (const Torus& torus : scene.tori) {
+        arrays.torus_transforms.push_back(transform_record(torus.transform));
+        arrays.tori.push_back({
+            torus.big_radius, torus.small_radius, torus.theta_samples, torus.phi_samples,
+            torus.procedural ? torusProceduralFlag : 0u
+        });
+        arrays.add_name(torus.name);
+    }
+
+    for (const PolyLine& polyline : scene.polylines) {
+        arrays.polylines.push_back(add_points(polyline.points));
+        arrays.add_name(polyline.name);
+    }
+
+    for (const C0Bezier& curve : scene.curves) {
+        const RangeRecord range = add_points(curve.control_points);
+        arrays.curves.push_back({range.first, range.count, curve.show_control_polygon ? 0u : curveHidePolygonFlag});
+        arrays.add_name(curve.name);
+    }
+
+    return arrays;
+}
+
+// Replaces the scene's objects with the arrays' contents, keeping the cursor where it was. The pools are
+// reserved up front and points only look up their shared mesh, so the cost is one pass per array.
+inline void build_scene(const SceneFileView& view, Scene& scene, const SceneShaders& shaders) {
+    const Transform cursor_transform = scene.cursors.size() > 0 ? scene.cursor().transform : Transform::identity();
+    scene.clear();
+
+    Cursor cursor(shaders.cursor);
+    cursor.transform = cursor_transform;
+    scene.add(std::move(cursor));
+
+    scene.points.reserve(view.point_positions.size());
+    scene.tori.reserve(view.tori.size());
+    scene.polylines.reserve(view.polylines.size());
+    scene.curves.reserve(view.curves.size());
+    scene.order.reserve(view.object_count() + 1);
+
+    size_t object = 0;
+    auto named = [&](Object& created) {
+        if (std::string_view name = view.name(object++); !name.empty()) {
+            created.name = name;
+        }
+    };
+
+    std::vector<Handle> point_handles;
+    point_handles.reserve(view.point_positions.size());
+
+    for (const vec3& position : view.point_positions) {
+        Point point(shaders.point);
+        point.transform.translation = position;
+        named(point);
+        point_handles.push_back(scene.add(std::move(point)).handle);
+    }
+
+    for (size_t i = 0; i < view.tori.size(); ++i) {
+        const TorusRecord& record = view.tori[i];
+        const TransformRecord& t = view.torus_transforms[i];
+
+        Transform transform;
+        transform.translation = vec3(t.translation);
+        transform.rotation = vec3(t.rotation);
+        transform.s = vec3(t.scale);
+
+        Torus torus(
+            record.big_radius, record.small_radius, record.theta_samples, record.phi_samples, shaders.torus,
+            transform, "torus", (record.flags & torusProceduralFlag) != 0
+        );
+        named(torus);
+        scene.add(std::move(torus));
+    }
+
+    auto handles = [&](uint32_t first, uint32_t count) {
+        std::vector<Handle> result(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            result[i] = point_handles[view.point_indices[first + i]];
+        }
+        return result;
+    };
+
+    for (const RangeRecord& range : view.polylines) {
+        PolyLine polyline(shaders.point, scene.points, handles(range.first, range.count));
+        named(polyline);
+        scene.add(std::move(polyline));
+    }
+
+    for (const CurveRecord& record : view.curves) {
+        C0Bezier curve(shaders.point, shaders.bezier, scene.points, handles(record.first, record.count));
+        curve.set_gpu_tessellation(shaders.gpu_tessellation);
+        curve.show_control_polygon = (record.flags & curveHidePolygonFlag) == 0;
+        named(curve);
+        scene.add(std::move(curve));
+    }
+}
+
+// Replaces the scene with the file's contents; the scene is left untouched when the file does not validate.
+inline bool load_scene_file(const char* path, Scene& scene, const SceneShaders& shaders) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to open scene file " << path << std::endl;
+        return false;
+    }
+
+    SceneFileView view;
+    if (!view.parse(file.data, file.size)) {
+        return false;
+    }
+
+    build_scene(view, scene, shaders);
+    return true;
+}
+
+inline bool save_scene_file(const char* path, const Scene& scene) {
+    return write_scene_file(path, SceneArrays::from(scene));
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <intersection.h>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+// Binary scene file: a header, a section table and one flat array of fixed-size records per section, each at a
+// 64-byte aligned offset. A mapped file is used in place, loading only validates the table and the indices, and
+// arrays such as the point positions can be handed to GL as they are.
+//
+// Objects are stored per type in the scene's pool order. Curves and polylines name their points by index into
+// the point array. Names are stored for points, tori, polylines and curves, in that order.
+
+static_assert(std::endian::native == std::endian::little, "scene files are little-endian");
+
+constexpr char sceneFileMagic[8] = {'M', 'G', '1', 'S', 'C', 'E', 'N', 'E'};
+constexpr uint32_t sceneFileVersion = 1;
+constexpr uint64_t sceneFileAlignment = 64;
+constexpr uint32_t sceneSectionCount = 8;
+
+enum class SceneSection : uint32_t {
+    PointPositions = 1, // vec3
+    TorusTransforms,    // TransformRecord
+    TorusParameters,    // TorusRecord
+    PolyLines,          // RangeRecord into PointIndices
+    Curves,             // CurveRecord into PointIndices
+    PointIndices,       // uint32_t
+    NameOffsets,        // uint32_t, one more than there are names
+    NameChars           // char
+};
+
+struct SceneFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t file_size;
+};
+
+struct SceneFileSection {
+    SceneSection type;
+    uint32_t element_size;
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct TransformRecord {
+    float translation[3];
+    float rotation[3];
+    float scale[3];
+};
+
+struct TorusRecord {
+    float big_radius;
+    float small_radius;
+    uint32_t theta_samples;
+    uint32_t phi_samples;
+    uint32_t flags;
+};
+
+struct RangeRecord {
+    uint32_t first;
+    uint32_t count;
+};
+
+struct CurveRecord {
+    uint32_t first;
+    uint32_t count;
+    uint32_t flags;
+};
+
+constexpr uint32_t torusProceduralFlag = 1;
+constexpr uint32_t curveHidePolygonFlag = 1;
+
+static_assert(sizeof(vec3) == 3 * sizeof(float));
+
+// the torus sample counts the editor offers
+constexpr unsigned int minTorusSamples = 3;
+constexpr unsigned int maxTorusSamples = 1000;
+
+// false for NaN as well, so the JSON reader checks its doubles with it before casting them
+inline bool valid_torus_samples(double samples) {
+    return samples >= minTorusSamples && samples <= maxTorusSamples;
+}
+
+// larger sample counts or non-finite radii would make the mesh builder allocate without bound
+inline bool valid_torus(const TorusRecord& torus) {
+    return std::isfinite(torus.big_radius) && std::isfinite(torus.small_radius) &&
+           valid_torus_samples(torus.theta_samples) && valid_torus_samples(torus.phi_samples);
+}
+
+inline bool valid_transform(const TransformRecord& transform) {
+    auto finite = [](const float (&v)[3]) { return std::isfinite(v[0]) && std::isfinite(v[1]) && std::isfinite(v[2]); };
+    return finite(transform.translation) && finite(transform.rotation) && finite(transform.scale);
+}
+
+// The arrays of a scene file, pointing into its mapping. parse() fails instead of returning arrays that reach
+// past the file or indices that reach past the point array.
+struct SceneFileView {
+    std::span<const vec3> point_positions;
+    std::span<const TransformRecord> torus_transforms;
+    std::span<const TorusRecord> tori;
+    std::span<const RangeRecord> polylines;
+    std::span<const CurveRecord> curves;
+    std::span<const uint32_t> point_indices;
+    std::span<const uint32_t> name_offsets;
+    std::span<const char> name_chars;
+
+    [[nodiscard]] size_t object_count() const {
+        return point_positions.size() + tori.size() + polylines.size() + curves.size();
+    }
+
+    // empty when the file has no names
+    [[nodiscard]] std::string_view name(size_t object) const {
+        if (object + 1 >= name_offsets.size()) {
+            return {};
+        }
+        return {name_chars.data() + name_offsets[object], name_offsets[object + 1] - name_offsets[object]};
+    }
+
+    bool parse(const std::byte* data, size_t size) {
+        *this = {};
+
+        if (size < sizeof(SceneFileHeader)) {
+            return error("file too small");
+        }
+
+        SceneFileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, sceneFileMagic, sizeof(sceneFileMagic)) != 0) {
+            return error("not a scene file");
+        }
+        if (header.version != sceneFileVersion) {
+            return error("unsupported version " + std::to_string(header.version));
+        }
+        if (header.file_size != size) {
+            return error("truncated file");
+        }
+
+        const uint64_t table_end = sizeof(SceneFileHeader) + uint64_t{header.section_count} * sizeof(SceneFileSection);
+        if (table_end > size) {
+            return error("truncated section table");
+        }
+
+        auto sections = reinterpret_cast<const SceneFileSection*>(data + sizeof(SceneFileHeader));
+        for (uint32_t i = 0; i < header.section_count; ++i) {
+            const SceneFileSection& section = sections[i];
+            bool known = true;
+            bool valid = true;
+
+            switch (section.type) {
+                case SceneSection::PointPositions: valid = bind(data, size, section, point_positions); break;
+                case SceneSection::TorusTransforms: valid = bind(data, size, section, torus_transforms); break;
+                case SceneSection::TorusParameters: valid = bind(data, size, section, tori); break;
+                case SceneSection::PolyLines: valid = bind(data, size, section, polylines); break;
+                case SceneSection::Curves: valid = bind(data, size, section, curves); break;
+                case SceneSection::PointIndices: valid = bind(data, size, section, point_indices); break;
+                case SceneSection::NameOffsets: valid = bind(data, size, section, name_offsets); break;
+                case SceneSection::NameChars: valid = bind(data, size, section, name_chars); break;
+                default: known = false; break;
+            }
+
+            // sections added by later minor revisions are skipped
+            if (known && !valid) {
+                return error("section " + std::to_string(static_cast<uint32_t>(section.type)) + " out of bounds");
+            }
+        }
+
+        return validate();
+    }
+
+    // index and range checks, also run on arrays the text importers filled
+    bool validate() {
+        if (torus_transforms.size() != tori.size()) {
+            return error("torus arrays differ in length");
+        }
+        for (const TorusRecord& torus : tori) {
+            if (!valid_torus(torus)) {
+                return error("torus parameters out of range");
+            }
+        }
+        for (const TransformRecord& transform : torus_transforms) {
+            if (!valid_transform(transform)) {
+                return error("non-finite torus transform");
+            }
+        }
+        for (const vec3& p : point_positions) {
+            if (!is_finite(p)) {
+                return error("non-finite point position");
+            }
+        }
+
+        const size_t points = point_positions.size();
+        const size_t indices = point_indices.size();
+        auto range_valid = [&](uint32_t first, uint32_t count) {
+            return first <= indices && count <= indices - first;
+        };
+
+        for (const RangeRecord& range : polylines) {
+            if (!range_valid(range.first, range.count)) {
+                return error("polyline range out of bounds");
+            }
+        }
+        for (const CurveRecord& curve : curves) {
+            if (!range_valid(curve.first, curve.count)) {
+                return error("curve range out of bounds");
+            }
+        }
+        for (uint32_t index : point_indices) {
+            if (index >= points) {
+                return error("control point index out of bounds");
+            }
+        }
+
+        if (!name_offsets.empty()) {
+            if (name_offsets.size() != object_count() + 1 || name_offsets.back() != name_chars.size()) {
+                return error("name table does not match the objects");
+            }
+            for (size_t i = 0; i + 1 < name_offsets.size(); ++i) {
+                if (name_offsets[i] > name_offsets[i + 1]) {
+                    return error("name offsets not increasing");
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    template <typename T>
+    static bool bind(const std::byte* data, size_t size, const SceneFileSection& section, std::span<const T>& out) {
+        if (section.element_size != sizeof(T) || section.offset % alignof(T) != 0 || section.offset > size) {
+            return false;
+        }
+        if (section.count > (size - section.offset) / sizeof(T)) {
+            return false;
+        }
+        out = {reinterpret_cast<const T*>(data + section.offset), static_cast<size_t>(section.count)};
+        return true;
+    }
+
+    bool error(const std::string& message) {
+        std::cerr << "Invalid scene file: " << message << std::endl;
+        *this = {};
+        return false;
+    }
+};
+
+struct Scene;
+struct Transform;
+
+// Owning counterpart of SceneFileView, filled from a scene for saving or by the text importers.
+struct SceneArrays {
+    std::vector<vec3> point_positions;
+    std::vector<TransformRecord> torus_transforms;
+    std::vector<TorusRecord> tori;
+    std::vector<RangeRecord> polylines;
+    std::vector<CurveRecord> curves;
+    std::vector<uint32_t> point_indices;
+    std::vector<uint32_t> name_offsets = {0};
+    std::vector<char> name_chars;
+
+    void add_name(std::string_view name) {
+        name_chars.insert(name_chars.end(), name.begin(), name.end());
+        name_offsets.push_back(name_chars.size());
+    }
+
+    // defined in scene_file.h, which has the scene
+    static TransformRecord transform_record(const Transform& t);
+    static SceneArrays from(const Scene& scene);
+
+    [[nodiscard]] SceneFileView view() const {
+        SceneFileView view;
+        view.point_positions = point_positions;
+        view.torus_transforms = torus_transforms;
+        view.tori = tori;
+        view.polylines = polylines;
+        view.curves = curves;
+        view.point_indices = point_indices;
+        view.name_offsets = name_offsets;
+        view.name_chars = name_chars;
+        return view;
+    }
+};
+
+// Writes the arrays as they are, validate() is not run
+inline bool write_scene_file(const char* path, const SceneArrays& arrays) {
+    std::vector<SceneFileSection> sections;
+    std::vector<std::pair<const void*, size_t>> payloads;
+    uint64_t offset = sizeof(SceneFileHeader) + sceneSectionCount * sizeof(SceneFileSection);
+
+    auto add_section = [&]<typename T>(SceneSection type, const std::vector<T>& array) {
+        offset = (offset + sceneFileAlignment - 1) & ~(sceneFileAlignment - 1);
+        sections.push_back({type, sizeof(T), offset, array.size()});
+        payloads.emplace_back(array.data(), array.size() * sizeof(T));
+        offset += array.size() * sizeof(T);
+    };
+
+    add_section(SceneSection::PointPositions, arrays.point_positions);
+    add_section(SceneSection::TorusTransforms, arrays.torus_transforms);
+    add_section(SceneSection::TorusParameters, arrays.tori);
+    add_section(SceneSection::PolyLines, arrays.polylines);
+    add_section(SceneSection::Curves, arrays.curves);
+    add_section(SceneSection::PointIndices, arrays.point_indices);
+    add_section(SceneSection::NameOffsets, arrays.name_offsets);
+    add_section(SceneSection::NameChars, arrays.name_chars);
+
+    SceneFileHeader header{};
+    std::memcpy(header.magic, sceneFileMagic, sizeof(sceneFileMagic));
+    header.version = sceneFileVersion;
+    header.section_count = sections.size();
+    header.file_size = offset;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(sections.data()), sections.size() * sizeof(SceneFileSection));
+
+    static constexpr char padding[sceneFileAlignment] = {};
+    uint64_t written = sizeof(header) + sections.size() * sizeof(SceneFileSection);
+
+    for (size_t i = 0; i < sections.size(); ++i) {
+        out.write(padding, sections[i].offset - written);
+        out.write(static_cast<const char*>(payloads[i].first), payloads[i].second);
+        written = sections[i].offset + payloads[i].second;
+    }
+
+    if (!out) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <scene_file.h>
+#include <scene_json_reader.h>
+#include "utility/json.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Saving and loading scenes in the JSON schema described in scene_json_reader.h.
+
+inline bool save_scene_json(const char* path, const Scene& scene) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    JsonWriter json(out);
+
+    auto write_vec3 = [&](std::string_view name, const vec3& v) {
+        json.key(name).begin_object().field("x", v.x).field("y", v.y).field("z", v.z).end_object();
+    };
+
+    // a point's id is its position in the pool, the other objects are numbered after the points
+    uint64_t id = scene.points.size();
+
+    json.begin_object();
+
+    json.key("points").begin_array();
+    for (size_t i = 0; i < scene.points.size(); ++i) {
+        const Point& point = scene.points.items[i];
+        json.begin_object().field("id", i).field("name", point.name);
+        write_vec3("position", point.transform.translation);
+        json.end_object();
+    }
+    json.end_array();
+
+    json.key("geometry").begin_array();
+    for (const Torus& torus : scene.tori) {
+        const quat q = from_euler_angles(torus.transform.rotation);
+
+        json.begin_object().field("objectType", "torus").field("id", id++).field("name", torus.name);
+        write_vec3("position", torus.transform.translation);
+        json.key("rotation").begin_object().field("x", q.x).field("y", q.y).field("z", q.z).field("w", q.w).end_object();
+        write_vec3("scale", torus.transform.s);
+        json.key("samples").begin_object()
+            .field("x", torus.theta_samples)
+            .field("y", torus.phi_samples)
+            .end_object();
+        json.field("smallRadius", torus.small_radius).field("largeRadius", torus.big_radius);
+        json.end_object();
+    }
+
+    for (const C0Bezier& curve : scene.curves) {
+        json.begin_object().field("objectType", "bezierC0").field("id", id++).field("name", curve.name);
+        json.key("controlPoints").begin_array();
+        for (Handle handle : curve.control_points) {
+            if (scene.points.contains(handle)) {
+                json.begin_object().field("id", scene.points.slots[handle.index].dense).end_object();
+            }
+        }
+        json.end_array();
+        json.end_object();
+    }
+    json.end_array();
+
+    json.end_object();
+    json.flush();
+
+    if (!out) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Replaces the scene with the document's contents; the scene is left untouched when the document is invalid.
+inline bool load_scene_json(const char* path, Scene& scene, const SceneShaders& shaders) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to open scene file " << path << std::endl;
+        return false;
+    }
+
+    SceneJsonReader reader({reinterpret_cast<const char*>(file.data), file.size});
+    if (!reader.read()) {
+        return false;
+    }
+
+    SceneFileView view = reader.arrays.view();
+    if (!view.validate()) {
+        return false;
+    }
+
+    build_scene(view, scene, shaders);
+    return true;
+}
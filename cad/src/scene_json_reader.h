@@ -0,0 +1,312 @@
+#pragma once
+
+#include <scene_format.h>
+#include "utility/json.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Scenes in the JSON schema shared with the other course tools:
+//
+//   { "points": [ { "id", "name", "position": {x, y, z} } ],
+//     "geometry": [ { "objectType": "torus", "id", "name", "position", "rotation": {x, y, z, w}, "scale",
+//                     "samples": {x, y}, "smallRadius", "largeRadius" },
+//                   { "objectType": "bezierC0", "id", "name", "controlPoints": [ { "id" } ] } ] }
+//
+// Ids are unique across the file. Import fills SceneArrays and goes through build_scene like the binary format,
+// so objects are created in one batch after the whole document is read. Polylines have no counterpart in the
+// schema and are not exported; unknown object types and keys are skipped.
+
+// Reads the document into SceneArrays. Tori and curves are interleaved in "geometry" but the arrays keep names
+// per type, so their names are collected separately and appended after the points' names at the end.
+struct SceneJsonReader {
+    using Token = JsonReader::Token;
+
+    // ids are doubles in JSON, beyond 2^53 neighbouring integers are no longer told apart
+    static constexpr double maxId = 9007199254740992.0;
+
+    struct Names {
+        std::vector<uint32_t> lengths;
+        std::vector<char> chars;
+
+        void add(std::string_view name) {
+            lengths.push_back(name.size());
+            chars.insert(chars.end(), name.begin(), name.end());
+        }
+
+        void append_to(SceneArrays& arrays) const {
+            size_t offset = 0;
+            for (uint32_t length : lengths) {
+                arrays.add_name({chars.data() + offset, length});
+                offset += length;
+            }
+        }
+    };
+
+    JsonReader json;
+    SceneArrays arrays;
+    std::unordered_map<int64_t, uint32_t> point_index;
+    // control points are stored by id until every point is known, a curve may come before "points"
+    std::vector<int64_t> control_point_ids;
+    Names torus_names;
+    Names curve_names;
+    std::string name;
+    std::string object_type;
+
+    explicit SceneJsonReader(std::string_view text) : json(text) {}
+
+    bool read() {
+        if (json.next() != Token::BeginObject) {
+            return fail("expected an object");
+        }
+
+        for (Token token = json.next(); token != Token::EndObject; token = json.next()) {
+            if (token != Token::Key) {
+                return fail("expected a key");
+            }
+
+            bool ok;
+            if (json.string() == "points") {
+                ok = read_array([&] { return read_point(); });
+            } else if (json.string() == "geometry") {
+                ok = read_array([&] { return read_geometry(); });
+            } else {
+                ok = json.skip(json.next());
+            }
+            if (!ok) {
+                return fail("malformed document");
+            }
+        }
+
+        arrays.point_indices.resize(control_point_ids.size());
+        for (size_t i = 0; i < control_point_ids.size(); ++i) {
+            auto found = point_index.find(control_point_ids[i]);
+            if (found == point_index.end()) {
+                return fail("curve refers to an unknown point id " + std::to_string(control_point_ids[i]));
+            }
+            arrays.point_indices[i] = found->second;
+        }
+
+        torus_names.append_to(arrays);
+        curve_names.append_to(arrays);
+        return true;
+    }
+
+private:
+    template <typename F>
+    bool read_array(F&& read_element) {
+        if (json.next() != Token::BeginArray) {
+            return false;
+        }
+        for (Token token = json.next(); token != Token::EndArray; token = json.next()) {
+            if (token != Token::BeginObject || !read_element()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the opening brace is already consumed; calls read_field(key, value token) for every member
+    template <typename F>
+    bool read_object(F&& read_field) {
+        for (Token token = json.next(); token != Token::EndObject; token = json.next()) {
+            if (token != Token::Key) {
+                return false;
+            }
+            // keys are short and compared right away, before the value token replaces the string
+            const std::string_view key = json.string();
+            char key_buffer[32];
+            const size_t key_size = std::min(key.size(), sizeof(key_buffer));
+            std::copy_n(key.data(), key_size, key_buffer);
+
+            if (!read_field(std::string_view(key_buffer, key_size), json.next())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // reads {x, y, z[, w]} into components in that order, missing components keep their value
+    template <typename T>
+    bool read_components(Token token, T* components, std::string_view names) {
+        if (token != Token::BeginObject) {
+            return false;
+        }
+        return read_object([&](std::string_view key, Token value) {
+            const size_t component = key.size() == 1 ? names.find(key[0]) : std::string_view::npos;
+            if (component == std::string_view::npos || value != Token::Number) {
+                return json.skip(value);
+            }
+            components[component] = static_cast<T>(json.number());
+            return true;
+        });
+    }
+
+    bool read_name(Token value) {
+        if (value != Token::String) {
+            return json.skip(value);
+        }
+        name = json.string();
+        return true;
+    }
+
+    bool read_point() {
+        float position[3] = {0.0f, 0.0f, 0.0f};
+        // a point without an id is loaded but no curve can refer to it
+        bool has_id = false;
+        int64_t id = 0;
+        name.clear();
+
+        const bool ok = read_object([&](std::string_view key, Token value) {
+            if (key == "id" && value == Token::Number) {
+                has_id = true;
+                return read_id(id);
+            }
+            if (key == "name") {
+                return read_name(value);
+            }
+            if (key == "position") {
+                return read_components(value, position, "xyz");
+            }
+            return json.skip(value);
+        });
+
+        if (!ok) {
+            return false;
+        }
+
+        if (has_id && !point_index.emplace(id, arrays.point_positions.size()).second) {
+            json.error = "duplicate point id " + std::to_string(id);
+            return false;
+        }
+        arrays.point_positions.emplace_back(position[0], position[1], position[2]);
+        arrays.add_name(name);
+        return true;
+    }
+
+    bool read_geometry() {
+        float position[3] = {0.0f, 0.0f, 0.0f};
+        float rotation[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        float scale[3] = {1.0f, 1.0f, 1.0f};
+        // kept as doubles until checked, casting an out-of-range double to an integer is undefined
+        double samples[2] = {4.0, 4.0};
+        float small_radius = 0.1f;
+        float large_radius = 1.0f;
+        const size_t first_control_point = control_point_ids.size();
+        name.clear();
+        object_type.clear();
+
+        const bool ok = read_object([&](std::string_view key, Token value) {
+            if (key == "objectType" && value == Token::String) {
+                object_type = json.string();
+                return true;
+            }
+            if (key == "name") {
+                return read_name(value);
+            }
+            if (key == "position") {
+                return read_components(value, position, "xyz");
+            }
+            if (key == "rotation") {
+                return read_components(value, rotation, "xyzw");
+            }
+            if (key == "scale") {
+                return read_components(value, scale, "xyz");
+            }
+            if (key == "samples") {
+                return read_components(value, samples, "xy");
+            }
+            if (key == "smallRadius" && value == Token::Number) {
+                small_radius = static_cast<float>(json.number());
+                return true;
+            }
+            if (key == "largeRadius" && value == Token::Number) {
+                large_radius = static_cast<float>(json.number());
+                return true;
+            }
+            if (key == "controlPoints" && value == Token::BeginArray) {
+                return read_control_points();
+            }
+            return json.skip(value);
+        });
+
+        if (!ok) {
+            return false;
+        }
+
+        if (object_type == "torus") {
+            if (!valid_torus_samples(samples[0]) || !valid_torus_samples(samples[1])) {
+                // read() reports the reader's error with the line
+                json.error = "torus samples out of range";
+                return false;
+            }
+
+            const vec3 euler = eulerAngles(quat(rotation[3], rotation[0], rotation[1], rotation[2]));
+            arrays.torus_transforms.push_back({
+                {position[0], position[1], position[2]},
+                {euler.x, euler.y, euler.z},
+                {scale[0], scale[1], scale[2]}
+            });
+            arrays.tori.push_back({
+                large_radius, small_radius,
+                static_cast<uint32_t>(samples[0]), static_cast<uint32_t>(samples[1]), 0u
+            });
+            torus_names.add(name);
+        } else if (object_type == "bezierC0") {
+            arrays.curves.push_back({
+                static_cast<uint32_t>(first_control_point),
+                static_cast<uint32_t>(control_point_ids.size() - first_control_point),
+                0u
+            });
+            curve_names.add(name);
+        } else {
+            control_point_ids.resize(first_control_point);
+        }
+        return true;
+    }
+
+    bool read_control_points() {
+        for (Token token = json.next(); token != Token::EndArray; token = json.next()) {
+            if (token != Token::BeginObject) {
+                return false;
+            }
+            const bool ok = read_object([&](std::string_view key, Token value) {
+                if (key == "id" && value == Token::Number) {
+                    int64_t id;
+                    if (!read_id(id)) {
+                        return false;
+                    }
+                    control_point_ids.push_back(id);
+                    return true;
+                }
+                return json.skip(value);
+            });
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the number just read, rejected unless it is an integer a double holds exactly; casting anything else,
+    // 1e300 or infinity, to an integer is undefined
+    bool read_id(int64_t& id) {
+        const double value = json.number();
+        if (!(std::abs(value) <= maxId) || value != std::trunc(value)) {
+            json.error = "invalid id";
+            return false;
+        }
+        id = static_cast<int64_t>(value);
+        return true;
+    }
+
+    bool fail(const std::string& message) {
+        std::cerr << "Invalid JSON scene (line " << json.line() << "): "
+                  << (json.error.empty() ? message : json.error) << std::endl;
+        return false;
+    }
+};
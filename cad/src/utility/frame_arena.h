@@ -0,0 +1,95 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator for data that lives at most until the end of the frame. Deallocation is a no-op and reset()
+// rewinds the whole arena at once. Requests that do not fit the block get their own allocation for the rest of
+// the frame, and the next reset grows the block to cover them, so a steady frame makes no heap allocations.
+struct FrameArena final : std::pmr::memory_resource {
+    static constexpr size_t defaultCapacity = 1 << 20;
+
+    std::unique_ptr<std::byte[]> block;
+    size_t capacity;
+    size_t offset = 0;
+    std::vector<std::unique_ptr<std::byte[]>> overflow;
+    size_t overflow_bytes = 0;
+
+    // the block is allocated on first use, threads that never touch their arena do not pay for it
+    explicit FrameArena(size_t capacity = defaultCapacity) : capacity(capacity) {}
+
+    void reset() {
+        if (!overflow.empty()) {
+            capacity = std::bit_ceil(offset + overflow_bytes);
+            block.reset();
+            overflow.clear();
+            overflow_bytes = 0;
+        }
+        offset = 0;
+    }
+
+    [[nodiscard]] size_t used() const {
+        return offset + overflow_bytes;
+    }
+
+    // Releases everything allocated after its construction when it goes out of scope, for transient data that
+    // would otherwise pile up within one frame (e.g. every level of a rebuilt mesh).
+    struct Scope {
+        FrameArena& arena;
+        size_t offset;
+
+        explicit Scope(FrameArena& arena) : arena(arena), offset(arena.offset) {}
+        ~Scope() {
+            arena.offset = offset;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (!block) {
+            block = std::make_unique_for_overwrite<std::byte[]>(capacity);
+        }
+
+        const auto base = reinterpret_cast<uintptr_t>(block.get());
+        const uintptr_t start = (base + offset + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= base + capacity) {
+            offset = start + bytes - base;
+            return reinterpret_cast<void*>(start);
+        }
+
+        size_t size = bytes + alignment;
+        overflow.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+        overflow_bytes += size;
+
+        void* pointer = overflow.back().get();
+        return std::align(alignment, bytes, pointer, size);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// one arena per thread; the render loop resets the main thread's at the start of each frame and a worker resets
+// its own between jobs
+inline thread_local FrameArena frame_arena;
+
+// containers for per-frame scratch data, allocated from this thread's frame arena
+template <typename T>
+using FrameVector = std::pmr::vector<T>;
+
+template <typename T>
+FrameVector<T> frame_vector(size_t reserve = 0) {
+    FrameVector<T> result(&frame_arena);
+    result.reserve(reserve);
+    return result;
+}
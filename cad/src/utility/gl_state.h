@@ -0,0 +1,65 @@
+#pragma once
+
+// Thin cache in front of the GL binding calls the renderer issues per draw. Calls that would not change the
+// current state are skipped and counted, so the overlay can show how much redundant work the sorting saves.
+struct GLStateCache {
+    // no GL object has this name, so the first request for any binding always reaches GL
+    static constexpr unsigned int unknown = ~0u;
+
+    unsigned int program = unknown;
+    unsigned int vertex_array = unknown;
+    unsigned int array_buffer = unknown;
+
+    unsigned int changes = 0;
+    unsigned int skipped = 0;
+
+    // state set behind the cache's back (e.g. by the ImGui backend) is forgotten at the start of each frame
+    void begin_frame() {
+        *this = GLStateCache{};
+    }
+
+    // deleting a bound object resets the binding to 0 and its name may be handed out again
+    void forget_vertex_array(unsigned int value) {
+        if (value == vertex_array) {
+            vertex_array = unknown;
+        }
+    }
+
+    void forget_array_buffer(unsigned int value) {
+        if (value == array_buffer) {
+            array_buffer = unknown;
+        }
+    }
+
+    void use_program(unsigned int value) {
+        if (value == program) {
+            ++skipped;
+            return;
+        }
+        program = value;
+        ++changes;
+        glUseProgram(value);
+    }
+
+    void bind_vertex_array(unsigned int value) {
+        if (value == vertex_array) {
+            ++skipped;
+            return;
+        }
+        vertex_array = value;
+        ++changes;
+        glBindVertexArray(value);
+    }
+
+    void bind_array_buffer(unsigned int value) {
+        if (value == array_buffer) {
+            ++skipped;
+            return;
+        }
+        array_buffer = value;
+        ++changes;
+        glBindBuffer(GL_ARRAY_BUFFER, value);
+    }
+};
+
+inline GLStateCache gl_state;
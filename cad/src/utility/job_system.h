@@ -0,0 +1,170 @@
+#pragma once
+
+#include "frame_arena.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads with one job deque per thread. A thread takes the newest job of its own deque and,
+// when that is empty, steals the oldest job of another one, so the ranges a parallel_for splits off spread over
+// the idle workers. The thread waiting for a parallel_for runs jobs as well instead of blocking.
+//
+// Jobs may use their thread's frame arena for scratch data; a worker rewinds its arena after every job, so results
+// that outlive the job belong in the objects it works on.
+struct JobSystem {
+    struct Job {
+        void (*run)(const void* context, size_t begin, size_t end);
+        const void* context;
+        size_t begin;
+        size_t end;
+        std::atomic<size_t>* pending;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::thread> workers;
+    // queues[0] is shared by the threads outside the pool, queues[i + 1] belongs to worker i
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued = 0;
+    std::atomic<bool> stopping = false;
+
+    static inline thread_local unsigned int queue_index = 0;
+
+    void start(unsigned int worker_count) {
+        queues.clear();
+        for (unsigned int i = 0; i <= worker_count; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+
+        stopping = false;
+        workers.reserve(worker_count);
+        for (unsigned int i = 0; i < worker_count; ++i) {
+            workers.emplace_back([this, i] { work(i + 1); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    // threads that run jobs, including the one calling parallel_for
+    [[nodiscard]] unsigned int thread_count() const {
+        return static_cast<unsigned int>(workers.size()) + 1;
+    }
+
+    // Calls f(begin, end) over [0, count) in ranges of at most grain elements and returns once all of them have
+    // run. Ranges run concurrently, f must be safe to call from several threads at once.
+    template <typename F>
+    void parallel_for(size_t count, size_t grain, const F& f) {
+        if (count == 0) {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+        if (workers.empty() || count <= grain) {
+            f(size_t{0}, count);
+            return;
+        }
+
+        const size_t job_count = (count + grain - 1) / grain;
+        std::atomic<size_t> pending = job_count;
+        auto run = [](const void* context, size_t begin, size_t end) {
+            (*static_cast<const F*>(context))(begin, end);
+        };
+
+        queued += job_count;
+        {
+            Queue& queue = *queues[queue_index];
+            std::lock_guard lock(queue.mutex);
+            for (size_t begin = 0; begin < count; begin += grain) {
+                queue.jobs.push_back({run, &f, begin, std::min(begin + grain, count), &pending});
+            }
+        }
+        {
+            // a worker between checking queued and going to sleep holds the mutex, so it cannot miss the wake-up
+            std::lock_guard lock(sleep_mutex);
+        }
+        wake.notify_all();
+
+        while (pending.load(std::memory_order_acquire) > 0) {
+            if (!run_one()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    bool pop(Job& job) {
+        const size_t own = queue_index;
+        {
+            Queue& queue = *queues[own];
+            std::lock_guard lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+                --queued;
+                return true;
+            }
+        }
+
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue& queue = *queues[(own + i) % queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+                --queued;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool run_one() {
+        Job job;
+        if (!pop(job)) {
+            return false;
+        }
+        job.run(job.context, job.begin, job.end);
+        // the last access to the job's batch, its owner may return as soon as pending reaches zero
+        job.pending->fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    void work(unsigned int index) {
+        queue_index = index;
+
+        while (true) {
+            if (run_one()) {
+                frame_arena.reset();
+                continue;
+            }
+
+            std::unique_lock lock(sleep_mutex);
+            wake.wait(lock, [&] { return queued > 0 || stopping; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+    }
+};
+
+inline JobSystem job_system;
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Streaming JSON writer. Output is collected in a buffer that is flushed to the stream whenever it passes
+// flushSize, so writing a large document keeps a bounded amount of memory. Commas are inserted automatically.
+struct JsonWriter {
+    static constexpr size_t flushSize = 1 << 16;
+
+    std::ostream& out;
+    std::string buffer;
+    // one entry per open container, true until its first element is written
+    std::vector<bool> first;
+    bool after_key = false;
+
+    explicit JsonWriter(std::ostream& out) : out(out) {
+        buffer.reserve(flushSize + 256);
+    }
+
+    ~JsonWriter() {
+        flush();
+    }
+
+    void flush() {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    JsonWriter& begin_object() {
+        separate();
+        buffer += '{';
+        first.push_back(true);
+        return *this;
+    }
+
+    JsonWriter& end_object() {
+        first.pop_back();
+        buffer += '}';
+        maybe_flush();
+        return *this;
+    }
+
+    JsonWriter& begin_array() {
+        separate();
+        buffer += '[';
+        first.push_back(true);
+        return *this;
+    }
+
+    JsonWriter& end_array() {
+        first.pop_back();
+        buffer += ']';
+        maybe_flush();
+        return *this;
+    }
+
+    JsonWriter& key(std::string_view name) {
+        separate();
+        write_string(name);
+        buffer += ':';
+        after_key = true;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view text) {
+        separate();
+        write_string(text);
+        return *this;
+    }
+
+    JsonWriter& value(const char* text) {
+        return value(std::string_view(text));
+    }
+
+    JsonWriter& value(bool flag) {
+        separate();
+        buffer += flag ? "true" : "false";
+        return *this;
+    }
+
+    // shortest representation that reads back to the same value
+    template <typename T>
+    requires std::is_arithmetic_v<T>
+    JsonWriter& value(T number) {
+        separate();
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        buffer.append(digits, result.ptr);
+        return *this;
+    }
+
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& field_value) {
+        key(name);
+        return value(field_value);
+    }
+
+private:
+    void separate() {
+        if (after_key) {
+            after_key = false;
+            return;
+        }
+        if (!first.empty()) {
+            if (!first.back()) {
+                buffer += ',';
+            }
+            first.back() = false;
+        }
+    }
+
+    void maybe_flush() {
+        if (buffer.size() >= flushSize) {
+            flush();
+        }
+    }
+
+    void write_string(std::string_view text) {
+        buffer += '"';
+        for (char c : text) {
+            switch (c) {
+                case '"': buffer += "\\\""; break;
+                case '\\': buffer += "\\\\"; break;
+                case '\n': buffer += "\\n"; break;
+                case '\r': buffer += "\\r"; break;
+                case '\t': buffer += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        static constexpr char hex[] = "0123456789abcdef";
+                        buffer += "\\u00";
+                        buffer += hex[(c >> 4) & 0xf];
+                        buffer += hex[c & 0xf];
+                    } else {
+                        buffer += c;
+                    }
+            }
+        }
+        buffer += '"';
+    }
+};
+
+// Pull parser over a complete document in memory (e.g. a mapped file). next() returns one token at a time;
+// strings are views into the document and only strings with escapes are decoded, into a buffer reused between
+// tokens. Nothing else allocates.
+struct JsonReader {
+    enum class Token {
+        BeginObject,
+        EndObject,
+        BeginArray,
+        EndArray,
+        Key,
+        String,
+        Number,
+        True,
+        False,
+        Null,
+        End,
+        Error
+    };
+
+    std::string_view text;
+    size_t position = 0;
+    std::string_view current_string;
+    double current_number = 0.0;
+    std::string unescaped;
+    std::string error;
+
+    explicit JsonReader(std::string_view text) : text(text) {}
+
+    // the key or string value of the last token, valid until the next call
+    [[nodiscard]] std::string_view string() const {
+        return current_string;
+    }
+
+    [[nodiscard]] double number() const {
+        return current_number;
+    }
+
+    Token next() {
+        skip_separators();
+        if (position >= text.size()) {
+            return Token::End;
+        }
+
+        const char c = text[position];
+        switch (c) {
+            case '{': ++position; return Token::BeginObject;
+            case '}': ++position; return Token::EndObject;
+            case '[': ++position; return Token::BeginArray;
+            case ']': ++position; return Token::EndArray;
+            case '"': {
+                if (!read_string()) {
+                    return Token::Error;
+                }
+                skip_whitespace();
+                if (position < text.size() && text[position] == ':') {
+                    ++position;
+                    return Token::Key;
+                }
+                return Token::String;
+            }
+            case 't': return literal("true", Token::True);
+            case 'f': return literal("false", Token::False);
+            case 'n': return literal("null", Token::Null);
+            default: return read_number();
+        }
+    }
+
+    // skips the value that starts with token, including everything nested in it
+    bool skip(Token token) {
+        if (token != Token::BeginObject && token != Token::BeginArray) {
+            return token != Token::Error && token != Token::End;
+        }
+
+        unsigned int depth = 1;
+        while (depth > 0) {
+            switch (next()) {
+                case Token::BeginObject:
+                case Token::BeginArray: ++depth; break;
+                case Token::EndObject:
+                case Token::EndArray: --depth; break;
+                case Token::Error:
+                case Token::End: return false;
+                default: break;
+            }
+        }
+        return true;
+    }
+
+    // line of the current position, for error messages
+    [[nodiscard]] size_t line() const {
+        size_t result = 1;
+        for (size_t i = 0; i < position && i < text.size(); ++i) {
+            result += text[i] == '\n';
+        }
+        return result;
+    }
+
+private:
+    void skip_whitespace() {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\n' ||
+                                          text[position] == '\r' || text[position] == '\t')) {
+            ++position;
+        }
+    }
+
+    // commas and the colons after keys carry no information for a pull parser
+    void skip_separators() {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\n' ||
+                                          text[position] == '\r' || text[position] == '\t' ||
+                                          text[position] == ',')) {
+            ++position;
+        }
+    }
+
+    Token literal(std::string_view word, Token token) {
+        if (text.substr(position, word.size()) != word) {
+            return fail("unexpected character");
+        }
+        position += word.size();
+        return token;
+    }
+
+    Token read_number() {
+        const char* begin = text.data() + position;
+        auto [end, ec] = std::from_chars(begin, text.data() + text.size(), current_number);
+        if (ec != std::errc()) {
+            return fail("invalid number");
+        }
+        position += end - begin;
+        return Token::Number;
+    }
+
+    bool read_string() {
+        const size_t begin = ++position;
+        bool escaped = false;
+
+        while (position < text.size() && text[position] != '"') {
+            if (text[position] == '\\') {
+                escaped = true;
+                ++position;
+            }
+            ++position;
+        }
+        if (position >= text.size()) {
+            fail("unterminated string");
+            return false;
+        }
+
+        current_string = text.substr(begin, position - begin);
+        ++position;
+
+        if (escaped) {
+            unescape(current_string);
+            current_string = unescaped;
+        }
+        return true;
+    }
+
+    void unescape(std::string_view raw) {
+        unescaped.clear();
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] != '\\' || i + 1 >= raw.size()) {
+                unescaped += raw[i];
+                continue;
+            }
+
+            switch (const char c = raw[++i]) {
+                case 'n': unescaped += '\n'; break;
+                case 'r': unescaped += '\r'; break;
+                case 't': unescaped += '\t'; break;
+                case 'b': unescaped += '\b'; break;
+                case 'f': unescaped += '\f'; break;
+                case 'u': {
+                    unsigned int code = 0;
+                    if (i + 4 < raw.size()) {
+                        std::from_chars(raw.data() + i + 1, raw.data() + i + 5, code, 16);
+                        i += 4;
+                    }
+                    append_utf8(code);
+                    break;
+                }
+                default: unescaped += c; break;
+            }
+        }
+    }
+
+    // surrogate pairs are not combined, names in scene files do not need them
+    void append_utf8(unsigned int code) {
+        if (code < 0x80) {
+            unescaped += static_cast<char>(code);
+        } else if (code < 0x800) {
+            unescaped += static_cast<char>(0xc0 | (code >> 6));
+            unescaped += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            unescaped += static_cast<char>(0xe0 | (code >> 12));
+            unescaped += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            unescaped += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    Token fail(const char* message) {
+        error = message;
+        return Token::Error;
+    }
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <string>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read-only mapping of a whole file, mmap on POSIX and a file mapping object on Windows
+struct MappedFile {
+    const std::byte* data = nullptr;
+    size_t size = 0;
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _WIN32
+    // path is UTF-8 like everywhere else in the editor
+    bool open(const char* path) {
+        close();
+
+        const int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+        if (length == 0) {
+            return false;
+        }
+        std::wstring wide_path(length, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, path, -1, wide_path.data(), length);
+
+        HANDLE file = CreateFileW(
+            wide_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+        );
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER file_size {};
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        // the view keeps the mapping alive, and the mapping the file
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view == nullptr) {
+            return false;
+        }
+
+        data = static_cast<const std::byte*>(view);
+        size = static_cast<size_t>(file_size.QuadPart);
+        return true;
+    }
+
+    void close() {
+        if (data != nullptr) {
+            UnmapViewOfFile(data);
+            data = nullptr;
+            size = 0;
+        }
+    }
+#else
+    bool open(const char* path) {
+        close();
+
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+
+        madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+        data = static_cast<const std::byte*>(mapping);
+        size = info.st_size;
+        return true;
+    }
+
+    void close() {
+        if (data != nullptr) {
+            munmap(const_cast<std::byte*>(data), size);
+            data = nullptr;
+            size = 0;
+        }
+    }
+#endif
+
+    ~MappedFile() {
+        close();
+    }
+};
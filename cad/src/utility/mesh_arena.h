@@ -0,0 +1,198 @@
+#pragma once
+
+#include "gl_state.h"
+#include "stream_buffer.h"
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <vector>
+
+// First-fit allocator over an abstract range of units, free blocks are kept sorted by offset and coalesced on free.
+struct FreeListAllocator {
+    static constexpr size_t invalid = ~size_t(0);
+
+    size_t capacity = 0;
+    std::map<size_t, size_t> free_blocks; // offset -> size
+
+    void grow(size_t new_capacity) {
+        if (new_capacity > capacity) {
+            free(capacity, new_capacity - capacity);
+            capacity = new_capacity;
+        }
+    }
+
+    size_t allocate(size_t size, size_t alignment = 1) {
+        for (auto it = free_blocks.begin(); it != free_blocks.end(); ++it) {
+            const size_t block_offset = it->first;
+            const size_t block_size = it->second;
+            const size_t aligned = (block_offset + alignment - 1) / alignment * alignment;
+
+            if (aligned + size > block_offset + block_size) {
+                continue;
+            }
+
+            free_blocks.erase(it);
+            if (aligned > block_offset) {
+                free_blocks[block_offset] = aligned - block_offset;
+            }
+            if (aligned + size < block_offset + block_size) {
+                free_blocks[aligned + size] = block_offset + block_size - aligned - size;
+            }
+            return aligned;
+        }
+        return invalid;
+    }
+
+    void free(size_t offset, size_t size) {
+        if (size == 0) {
+            return;
+        }
+
+        auto next = free_blocks.lower_bound(offset);
+
+        if (next != free_blocks.begin()) {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset) {
+                offset = previous->first;
+                size += previous->second;
+                free_blocks.erase(previous);
+            }
+        }
+
+        if (next != free_blocks.end() && offset + size == next->first) {
+            size += next->second;
+            free_blocks.erase(next);
+        }
+
+        free_blocks[offset] = size;
+    }
+};
+
+// Where a mesh lives inside the arena. Indices are relative to first_vertex, so they can stay 16-bit for small meshes
+// even when the arena holds millions of vertices.
+struct MeshAllocation {
+    size_t first_vertex = 0;
+    size_t vertex_count = 0;
+    size_t index_offset = 0; // in bytes
+    size_t index_count = 0;
+    unsigned int index_type = GL_UNSIGNED_SHORT;
+
+    [[nodiscard]] size_t index_size() const {
+        return index_type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    }
+
+    [[nodiscard]] size_t first_index() const {
+        return index_offset / index_size();
+    }
+};
+
+// Shared vertex and index storage for static wireframe meshes with a vec3 position format. All of them are drawn
+// through one VAO, which lets the renderer merge them into glMultiDrawElementsIndirect calls.
+struct MeshArena {
+    static constexpr size_t vertexSize = 3 * sizeof(float);
+
+    unsigned int VAO = 0;
+    unsigned int vertex_buffer = 0;
+    unsigned int index_buffer = 0;
+    FreeListAllocator vertices; // in vertices
+    FreeListAllocator indices; // in bytes
+
+    void init(size_t vertex_capacity, size_t index_capacity) {
+        glCreateVertexArrays(1, &VAO);
+        glEnableVertexArrayAttrib(VAO, 0);
+        glVertexArrayAttribFormat(VAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(VAO, 0, 0);
+
+        vertex_buffer = resize_buffer(0, 0, vertex_capacity * vertexSize);
+        index_buffer = resize_buffer(0, 0, index_capacity);
+        vertices.grow(vertex_capacity);
+        indices.grow(index_capacity);
+
+        bind_buffers();
+    }
+
+    // any contiguous containers, e.g. std::vector or the FrameVector scratch the meshes are built in
+    template <typename Vertices, typename Edges>
+    MeshAllocation allocate(const Vertices& mesh_vertices, const Edges& mesh_edges) {
+        using V = typename Vertices::value_type;
+        using E = typename Edges::value_type;
+        static_assert(sizeof(V) == vertexSize);
+        static_assert(sizeof(E) == 2 * sizeof(unsigned short) || sizeof(E) == 2 * sizeof(unsigned int));
+
+        MeshAllocation mesh;
+        mesh.vertex_count = mesh_vertices.size();
+        mesh.index_count = mesh_edges.size() * 2;
+        mesh.index_type = sizeof(E) == 2 * sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+        const size_t index_bytes = mesh_edges.size() * sizeof(E);
+
+        mesh.first_vertex = vertices.allocate(mesh.vertex_count);
+        if (mesh.first_vertex == FreeListAllocator::invalid) {
+            grow_vertices(mesh.vertex_count);
+            mesh.first_vertex = vertices.allocate(mesh.vertex_count);
+        }
+
+        mesh.index_offset = indices.allocate(index_bytes, mesh.index_size());
+        if (mesh.index_offset == FreeListAllocator::invalid) {
+            grow_indices(index_bytes + mesh.index_size());
+            mesh.index_offset = indices.allocate(index_bytes, mesh.index_size());
+        }
+
+        stream_buffer.upload(vertex_buffer, mesh.first_vertex * vertexSize, mesh_vertices.data(), mesh.vertex_count * vertexSize);
+        stream_buffer.upload(index_buffer, mesh.index_offset, mesh_edges.data(), index_bytes);
+
+        return mesh;
+    }
+
+    void free(MeshAllocation& mesh) {
+        if (mesh.vertex_count > 0) {
+            vertices.free(mesh.first_vertex, mesh.vertex_count);
+        }
+        if (mesh.index_count > 0) {
+            indices.free(mesh.index_offset, mesh.index_count * mesh.index_size());
+        }
+        mesh = MeshAllocation{};
+    }
+
+    void grow_vertices(size_t at_least) {
+        size_t capacity = std::max(vertices.capacity * 2, vertices.capacity + at_least);
+        vertex_buffer = resize_buffer(vertex_buffer, vertices.capacity * vertexSize, capacity * vertexSize);
+        vertices.grow(capacity);
+        bind_buffers();
+    }
+
+    void grow_indices(size_t at_least) {
+        size_t capacity = std::max(indices.capacity * 2, indices.capacity + at_least);
+        index_buffer = resize_buffer(index_buffer, indices.capacity, capacity);
+        indices.grow(capacity);
+        bind_buffers();
+    }
+
+    void destroy() {
+        glDeleteBuffers(1, &vertex_buffer);
+        glDeleteBuffers(1, &index_buffer);
+        glDeleteVertexArrays(1, &VAO);
+        gl_state.forget_vertex_array(VAO);
+    }
+
+    // immutable storage cannot be resized, so growing means a new buffer and a GPU-side copy of the old contents
+    static unsigned int resize_buffer(unsigned int buffer, size_t old_size, size_t new_size) {
+        unsigned int resized;
+        glCreateBuffers(1, &resized);
+        glNamedBufferStorage(resized, new_size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+        if (buffer != 0) {
+            glCopyNamedBufferSubData(buffer, resized, 0, 0, old_size);
+            glDeleteBuffers(1, &buffer);
+        }
+        return resized;
+    }
+
+private:
+    void bind_buffers() const {
+        glVertexArrayVertexBuffer(VAO, 0, vertex_buffer, 0, vertexSize);
+        glVertexArrayElementBuffer(VAO, index_buffer);
+    }
+};
+
+inline MeshArena mesh_arena;
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <myglm.h>
+#include "frame_arena.h"
+#include "mpsc_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// CPU side of a wireframe mesh, 16-bit edges when the vertex count allows it and 32-bit ones otherwise
+struct BuiltMesh {
+    std::vector<myglm::vec3> vertices;
+    std::vector<myglm::u16vec2> edges;
+    std::vector<myglm::u32vec2> edges32;
+};
+
+// the levels a request produced, tagged with the request's owner and version
+struct BuiltMeshes {
+    uint64_t owner = 0;
+    uint64_t version = 0;
+    std::vector<BuiltMesh> levels;
+};
+
+// Generates meshes away from the main thread. Objects submit a build function tagged with an owner id, which
+// stays with the object when it moves between pool slots, and a version that grows with every submission; only
+// the newest request of an owner is kept while it waits, so a slider drag builds at most one stale mesh. Results
+// come back through a lock-free queue that the main thread drains once per frame, uploading what still matches
+// its owner's current version.
+//
+// Build functions may use their thread's frame arena, which is rewound after every request.
+struct MeshBuilder {
+    using Build = std::function<void(std::vector<BuiltMesh>& levels)>;
+
+    static constexpr unsigned int maxWorkers = 2;
+
+    struct Request {
+        uint64_t owner;
+        uint64_t version;
+        Build build;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::deque<Request> requests;
+    bool stopping = false;
+    MpscQueue<BuiltMeshes> results;
+    std::atomic<uint64_t> next_owner = 1;
+
+    void start(unsigned int worker_count) {
+        stopping = false;
+        for (unsigned int i = 0; i < std::min(worker_count, maxWorkers); ++i) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+            requests.clear();
+        }
+        available.notify_all();
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    uint64_t new_owner() {
+        return next_owner.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // without workers the mesh is built right away, it is still picked up with the next take
+    void submit(uint64_t owner, uint64_t version, Build build) {
+        if (workers.empty()) {
+            run({owner, version, std::move(build)});
+            return;
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            auto queued = std::find_if(requests.begin(), requests.end(), [&](const Request& request) {
+                return request.owner == owner;
+            });
+            if (queued != requests.end()) {
+                *queued = {owner, version, std::move(build)};
+                return;
+            }
+            requests.push_back({owner, version, std::move(build)});
+        }
+        available.notify_one();
+    }
+
+    // main thread only
+    bool take(BuiltMeshes& meshes) {
+        return results.pop(meshes);
+    }
+
+private:
+    void run(Request request) {
+        BuiltMeshes meshes;
+        meshes.owner = request.owner;
+        meshes.version = request.version;
+        request.build(meshes.levels);
+        results.push(std::move(meshes));
+    }
+
+    void work() {
+        while (true) {
+            Request request;
+            {
+                std::unique_lock lock(mutex);
+                available.wait(lock, [&] { return !requests.empty() || stopping; });
+                if (stopping) {
+                    return;
+                }
+                request = std::move(requests.front());
+                requests.pop_front();
+            }
+
+            run(std::move(request));
+            frame_arena.reset();
+        }
+    }
+};
+
+inline MeshBuilder mesh_builder;
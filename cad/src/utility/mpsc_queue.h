@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free queue with any number of producers and one consumer (Vyukov's intrusive MPSC list). A
+// producer links its node with one exchange on head, the consumer follows next pointers from tail and never
+// touches head, so neither side waits for the other. A push that has exchanged head but not linked its node yet
+// makes pop report empty until it does, the value shows up on a later pop.
+template <typename T>
+struct MpscQueue {
+    struct Node {
+        std::atomic<Node*> next = nullptr;
+        T value;
+    };
+
+    MpscQueue() {
+        // the consumer's tail always points at a node whose value was already taken, initially an empty one
+        Node* stub = new Node();
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        while (tail) {
+            Node* next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    // any thread
+    void push(T value) {
+        Node* node = new Node();
+        node->value = std::move(value);
+
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // the consumer thread only
+    bool pop(T& value) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+
+        value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    std::atomic<Node*> head;
+    Node* tail;
+};
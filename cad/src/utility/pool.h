@@ -0,0 +1,187 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Names an element of a Pool. The generation is bumped whenever a slot is freed, so a handle kept past its
+// element's removal resolves to nothing instead of to whatever reuses the slot.
+struct Handle {
+    static constexpr uint32_t invalid = ~0u;
+
+    uint32_t index = invalid;
+    uint32_t generation = 0;
+
+    [[nodiscard]] bool valid() const {
+        return index != invalid;
+    }
+
+    bool operator==(const Handle&) const = default;
+};
+
+// Dense bitset indexed like the pool's items, one bit per element.
+struct BitSet {
+    std::vector<uint64_t> words;
+    size_t count = 0;
+
+    [[nodiscard]] bool test(size_t i) const {
+        return i / 64 < words.size() && (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    void set(size_t i, bool value) {
+        if (i / 64 >= words.size()) {
+            if (!value) {
+                return;
+            }
+            words.resize(i / 64 + 1, 0);
+        }
+
+        const uint64_t mask = uint64_t{1} << (i % 64);
+        if (((words[i / 64] & mask) != 0) == value) {
+            return;
+        }
+        words[i / 64] ^= mask;
+        if (value) {
+            ++count;
+        } else {
+            --count;
+        }
+    }
+
+    void clear() {
+        words.clear();
+        count = 0;
+    }
+
+    // calls visit(i) for every set bit in increasing order, skipping empty words
+    template <typename F>
+    void for_each(F&& visit) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1) {
+                visit(w * 64 + std::countr_zero(bits));
+            }
+        }
+    }
+};
+
+// Objects of one type stored contiguously, so per-frame passes over them are linear scans. Removal moves the last
+// element into the hole; handles stay valid across that because they go through the slot table. Elements are
+// swapped, never move-assigned over a live one, so a type only needs its moves to leave the source empty.
+template <typename T>
+struct Pool {
+    struct Slot {
+        uint32_t dense = Handle::invalid;
+        uint32_t generation = 0;
+    };
+
+    std::vector<T> items;
+    std::vector<uint32_t> item_slots; // dense index -> slot
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    BitSet selection; // indexed like items
+
+    Handle insert(T&& item) {
+        uint32_t slot;
+        if (free_slots.empty()) {
+            slot = slots.size();
+            slots.emplace_back();
+        } else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+
+        slots[slot].dense = items.size();
+        items.push_back(std::move(item));
+        item_slots.push_back(slot);
+        return {slot, slots[slot].generation};
+    }
+
+    template <typename... Args>
+    Handle emplace(Args&&... args) {
+        return insert(T(std::forward<Args>(args)...));
+    }
+
+    [[nodiscard]] bool contains(Handle handle) const {
+        return handle.index < slots.size() && slots[handle.index].generation == handle.generation &&
+            slots[handle.index].dense != Handle::invalid;
+    }
+
+    T* get(Handle handle) {
+        return contains(handle) ? &items[slots[handle.index].dense] : nullptr;
+    }
+
+    const T* get(Handle handle) const {
+        return contains(handle) ? &items[slots[handle.index].dense] : nullptr;
+    }
+
+    [[nodiscard]] Handle handle_of(size_t dense) const {
+        const uint32_t slot = item_slots[dense];
+        return {slot, slots[slot].generation};
+    }
+
+    void remove(Handle handle) {
+        if (!contains(handle)) {
+            return;
+        }
+
+        const uint32_t dense = slots[handle.index].dense;
+        const uint32_t last = items.size() - 1;
+
+        if (dense != last) {
+            std::swap(items[dense], items[last]);
+            const bool last_selected = selection.test(last);
+            selection.set(last, selection.test(dense));
+            selection.set(dense, last_selected);
+
+            item_slots[dense] = item_slots[last];
+            slots[item_slots[dense]].dense = dense;
+        }
+
+        selection.set(last, false);
+        items.pop_back();
+        item_slots.pop_back();
+
+        slots[handle.index].dense = Handle::invalid;
+        ++slots[handle.index].generation;
+        free_slots.push_back(handle.index);
+    }
+
+    [[nodiscard]] bool selected(Handle handle) const {
+        return contains(handle) && selection.test(slots[handle.index].dense);
+    }
+
+    void set_selected(Handle handle, bool value) {
+        if (contains(handle)) {
+            selection.set(slots[handle.index].dense, value);
+        }
+    }
+
+    [[nodiscard]] size_t size() const {
+        return items.size();
+    }
+
+    // destroys every element; outstanding handles stay invalid, the slots are reused with a new generation
+    void clear() {
+        for (uint32_t slot : item_slots) {
+            slots[slot].dense = Handle::invalid;
+            ++slots[slot].generation;
+            free_slots.push_back(slot);
+        }
+        items.clear();
+        item_slots.clear();
+        selection.clear();
+    }
+
+    void reserve(size_t count) {
+        items.reserve(count);
+        item_slots.reserve(count);
+        slots.reserve(count);
+    }
+
+    auto begin() { return items.begin(); }
+    auto end() { return items.end(); }
+    auto begin() const { return items.begin(); }
+    auto end() const { return items.end(); }
+};
@@ -0,0 +1,261 @@
+#pragma once
+
+#include "json.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Frame profiler for the main thread. CPU zones nest and are timed with the steady clock; GPU passes are timed
+// with GL_TIME_ELAPSED queries, which cannot nest, so passes must not overlap. Query results are read
+// gpuLatency frames later, when they are normally available, and never waited on: a frame whose queries are still
+// pending by then loses its GPU timings. The last historyFrames frames are kept for the profiler window and the
+// trace export. Names must be string literals or otherwise outlive the history.
+struct Profiler {
+    static constexpr size_t historyFrames = 240;
+    static constexpr unsigned int gpuLatency = 4;
+    static constexpr unsigned int maxGpuPasses = 16;
+
+    // times in milliseconds from the start of the frame
+    struct Zone {
+        const char* name;
+        uint32_t depth;
+        double begin;
+        double end;
+    };
+
+    struct GpuPass {
+        const char* name;
+        double duration;
+    };
+
+    struct Frame {
+        uint64_t index = 0;
+        // milliseconds since init
+        double start = 0.0;
+        double duration = 0.0;
+        std::vector<Zone> zones;
+        std::vector<GpuPass> gpu_passes;
+        bool gpu_ready = false;
+    };
+
+    struct GpuSlot {
+        std::array<unsigned int, maxGpuPasses> queries{};
+        std::array<const char*, maxGpuPasses> names{};
+        unsigned int count = 0;
+        uint64_t frame = 0;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point epoch;
+    Clock::time_point frame_begin;
+    // history is a ring, newest is the index of the last finished frame
+    std::vector<Frame> history;
+    size_t newest = 0;
+    size_t recorded = 0;
+    bool paused = false;
+
+    Frame current;
+    std::vector<size_t> open_zones;
+    uint64_t frame_index = 0;
+
+    std::array<GpuSlot, gpuLatency> gpu_slots;
+    bool gpu_pass_open = false;
+
+    void init() {
+        epoch = Clock::now();
+        history.resize(historyFrames);
+        for (GpuSlot& slot : gpu_slots) {
+            glCreateQueries(GL_TIME_ELAPSED, maxGpuPasses, slot.queries.data());
+        }
+    }
+
+    void destroy() {
+        for (GpuSlot& slot : gpu_slots) {
+            glDeleteQueries(maxGpuPasses, slot.queries.data());
+        }
+    }
+
+    void begin_frame() {
+        frame_begin = Clock::now();
+        current.index = frame_index;
+        current.start = milliseconds(frame_begin);
+        current.zones.clear();
+        current.gpu_passes.clear();
+        current.gpu_ready = false;
+        open_zones.clear();
+
+        // this frame's slot was last used gpuLatency frames ago
+        GpuSlot& slot = gpu_slots[frame_index % gpuLatency];
+        collect(slot);
+        slot.count = 0;
+        slot.frame = frame_index;
+    }
+
+    void end_frame() {
+        while (!open_zones.empty()) {
+            end_zone();
+        }
+        current.duration = since_frame_begin();
+        ++frame_index;
+
+        if (paused) {
+            return;
+        }
+        newest = (newest + 1) % history.size();
+        std::swap(history[newest], current);
+        recorded = std::min(recorded + 1, history.size());
+    }
+
+    void begin_zone(const char* name) {
+        open_zones.push_back(current.zones.size());
+        current.zones.push_back({name, static_cast<uint32_t>(open_zones.size() - 1), since_frame_begin(), 0.0});
+    }
+
+    void end_zone() {
+        current.zones[open_zones.back()].end = since_frame_begin();
+        open_zones.pop_back();
+    }
+
+    // passes past maxGpuPasses in a frame are not timed
+    void begin_gpu_pass(const char* name) {
+        GpuSlot& slot = gpu_slots[frame_index % gpuLatency];
+        if (slot.count == maxGpuPasses) {
+            return;
+        }
+        slot.names[slot.count] = name;
+        glBeginQuery(GL_TIME_ELAPSED, slot.queries[slot.count]);
+        gpu_pass_open = true;
+    }
+
+    void end_gpu_pass() {
+        if (!gpu_pass_open) {
+            return;
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        ++gpu_slots[frame_index % gpuLatency].count;
+        gpu_pass_open = false;
+    }
+
+    // ago = 0 is the newest finished frame
+    [[nodiscard]] const Frame* frame(size_t ago) const {
+        if (ago >= recorded) {
+            return nullptr;
+        }
+        return &history[(newest + history.size() - ago) % history.size()];
+    }
+
+    // Chrome trace event format, for chrome://tracing or Perfetto. GPU passes only have durations, so they are
+    // laid end to end from the start of their frame on a thread of their own.
+    bool export_trace(const char* path) const {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) {
+            std::cerr << "Failed to open " << path << " for writing" << std::endl;
+            return false;
+        }
+
+        constexpr int cpuThread = 1;
+        constexpr int gpuThread = 2;
+
+        JsonWriter json(out);
+        json.begin_object().field("displayTimeUnit", "ms");
+        json.key("traceEvents").begin_array();
+
+        auto thread_name = [&](int thread, const char* name) {
+            json.begin_object().field("name", "thread_name").field("ph", "M").field("pid", 1).field("tid", thread);
+            json.key("args").begin_object().field("name", name).end_object();
+            json.end_object();
+        };
+        auto event = [&](const char* name, int thread, double start, double duration) {
+            json.begin_object()
+                .field("name", name)
+                .field("ph", "X")
+                .field("pid", 1)
+                .field("tid", thread)
+                .field("ts", start * 1000.0)
+                .field("dur", duration * 1000.0)
+                .end_object();
+        };
+
+        thread_name(cpuThread, "CPU");
+        thread_name(gpuThread, "GPU");
+
+        for (size_t ago = recorded; ago-- > 0;) {
+            const Frame& f = *frame(ago);
+            event("frame", cpuThread, f.start, f.duration);
+            for (const Zone& zone : f.zones) {
+                event(zone.name, cpuThread, f.start + zone.begin, zone.end - zone.begin);
+            }
+
+            double gpu_start = f.start;
+            for (const GpuPass& pass : f.gpu_passes) {
+                event(pass.name, gpuThread, gpu_start, pass.duration);
+                gpu_start += pass.duration;
+            }
+        }
+
+        json.end_array();
+        json.end_object();
+        json.flush();
+
+        if (!out) {
+            std::cerr << "Failed to write " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    [[nodiscard]] double milliseconds(Clock::time_point time) const {
+        return std::chrono::duration<double, std::milli>(time - epoch).count();
+    }
+
+    [[nodiscard]] double since_frame_begin() const {
+        return std::chrono::duration<double, std::milli>(Clock::now() - frame_begin).count();
+    }
+
+    // reads the slot's queries into the frame that issued them, if it is still in the history
+    void collect(const GpuSlot& slot) {
+        if (slot.count == 0) {
+            return;
+        }
+
+        int available = 0;
+        glGetQueryObjectiv(slot.queries[slot.count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available || frame_index - slot.frame > recorded) {
+            return;
+        }
+
+        Frame& f = history[(newest + history.size() - (frame_index - 1 - slot.frame)) % history.size()];
+        if (f.index != slot.frame) {
+            return;
+        }
+
+        f.gpu_passes.clear();
+        for (unsigned int i = 0; i < slot.count; ++i) {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &nanoseconds);
+            f.gpu_passes.push_back({slot.names[i], static_cast<double>(nanoseconds) * 1e-6});
+        }
+        f.gpu_ready = true;
+    }
+};
+
+inline Profiler profiler;
+
+// CPU zone for the rest of the enclosing scope
+struct ProfileZone {
+    explicit ProfileZone(const char* name) {
+        profiler.begin_zone(name);
+    }
+
+    ~ProfileZone() {
+        profiler.end_zone();
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// Offscreen target the scene is drawn into: a multisampled color attachment and an R32UI attachment holding the
+// pick id of the object covering each pixel (0 for the background). The color is resolved into the default
+// framebuffer at the end of the scene pass, the ids are resolved into a single-sampled texture only when picking.
+struct SceneFramebuffer {
+    static constexpr int samples = 8;
+
+    unsigned int FBO = 0;
+    unsigned int color = 0;
+    unsigned int ids = 0;
+    unsigned int depth = 0;
+
+    unsigned int resolve_FBO = 0;
+    unsigned int resolved_ids = 0;
+
+    int width = 0;
+    int height = 0;
+
+    void init(int width, int height) {
+        glCreateFramebuffers(1, &FBO);
+        glCreateFramebuffers(1, &resolve_FBO);
+        resize(width, height);
+    }
+
+    void resize(int width, int height) {
+        if (width == this->width && height == this->height) {
+            return;
+        }
+        this->width = std::max(width, 1);
+        this->height = std::max(height, 1);
+
+        release_attachments();
+
+        glCreateRenderbuffers(1, &color);
+        glNamedRenderbufferStorageMultisample(color, samples, GL_RGBA8, this->width, this->height);
+        glCreateRenderbuffers(1, &ids);
+        glNamedRenderbufferStorageMultisample(ids, samples, GL_R32UI, this->width, this->height);
+        glCreateRenderbuffers(1, &depth);
+        glNamedRenderbufferStorageMultisample(depth, samples, GL_DEPTH24_STENCIL8, this->width, this->height);
+
+        glNamedFramebufferRenderbuffer(FBO, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glNamedFramebufferRenderbuffer(FBO, GL_COLOR_ATTACHMENT1, GL_RENDERBUFFER, ids);
+        glNamedFramebufferRenderbuffer(FBO, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+        constexpr unsigned int draw_buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glNamedFramebufferDrawBuffers(FBO, 2, draw_buffers);
+
+        glCreateRenderbuffers(1, &resolved_ids);
+        glNamedRenderbufferStorage(resolved_ids, GL_R32UI, this->width, this->height);
+        glNamedFramebufferRenderbuffer(resolve_FBO, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolved_ids);
+        glNamedFramebufferReadBuffer(resolve_FBO, GL_COLOR_ATTACHMENT0);
+    }
+
+    void begin(const float clear_color[4]) const {
+        constexpr unsigned int no_object[4] = {0, 0, 0, 0};
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glClearNamedFramebufferfv(FBO, GL_COLOR, 0, clear_color);
+        glClearNamedFramebufferuiv(FBO, GL_COLOR, 1, no_object);
+        glClearNamedFramebufferfi(FBO, GL_DEPTH_STENCIL, 0, 1.0f, 0);
+    }
+
+    // resolves the color into the default framebuffer, which is bound afterwards for the UI
+    void end() const {
+        glNamedFramebufferReadBuffer(FBO, GL_COLOR_ATTACHMENT0);
+        glBlitNamedFramebuffer(FBO, 0, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // integer attachments cannot be averaged, the blit takes a single sample per pixel
+    void resolve_ids(int x, int y, int w, int h) const {
+        glNamedFramebufferReadBuffer(FBO, GL_COLOR_ATTACHMENT1);
+        glBlitNamedFramebuffer(FBO, resolve_FBO, x, y, x + w, y + h, x, y, x + w, y + h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+
+    void destroy() {
+        release_attachments();
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteFramebuffers(1, &resolve_FBO);
+        FBO = resolve_FBO = 0;
+    }
+
+private:
+    void release_attachments() {
+        const unsigned int renderbuffers[] = {color, ids, depth, resolved_ids};
+        glDeleteRenderbuffers(4, renderbuffers);
+        color = ids = depth = resolved_ids = 0;
+    }
+};
+
+// Box-select readback of the id attachment. The copy into a pixel buffer object is queued behind the frame's
+// draws and fenced; the ids are mapped once the fence has signalled, so the CPU never waits on the GPU.
+struct PickReadback {
+    unsigned int PBO = 0;
+    size_t capacity = 0;
+    GLsync fence = nullptr;
+    size_t pixel_count = 0;
+
+    // x and y are in framebuffer coordinates, with the origin in the bottom-left corner
+    void request(const SceneFramebuffer& framebuffer, int x, int y, int w, int h) {
+        x = std::clamp(x, 0, framebuffer.width - 1);
+        y = std::clamp(y, 0, framebuffer.height - 1);
+        w = std::clamp(w, 1, framebuffer.width - x);
+        h = std::clamp(h, 1, framebuffer.height - y);
+
+        cancel();
+
+        pixel_count = static_cast<size_t>(w) * h;
+        const size_t size = pixel_count * sizeof(unsigned int);
+
+        if (size > capacity) {
+            glDeleteBuffers(1, &PBO);
+            capacity = std::max(size, capacity * 2);
+            glCreateBuffers(1, &PBO);
+            glNamedBufferStorage(PBO, capacity, nullptr, GL_MAP_READ_BIT);
+        }
+
+        framebuffer.resolve_ids(x, y, w, h);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.resolve_FBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PBO);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(x, y, w, h, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.FBO);
+
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // distinct non-zero ids of the finished readback, false while it is still in flight or none was requested
+    bool poll(std::vector<unsigned int>& picked) {
+        if (fence == nullptr) {
+            return false;
+        }
+
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+            return false;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+
+        picked.clear();
+
+        const size_t size = pixel_count * sizeof(unsigned int);
+        auto pixels = static_cast<const unsigned int*>(glMapNamedBufferRange(PBO, 0, size, GL_MAP_READ_BIT));
+        if (pixels != nullptr) {
+            for (size_t i = 0; i < pixel_count; ++i) {
+                if (pixels[i] != 0) {
+                    picked.push_back(pixels[i]);
+                }
+            }
+            glUnmapNamedBuffer(PBO);
+        }
+
+        std::sort(picked.begin(), picked.end());
+        picked.erase(std::unique(picked.begin(), picked.end()), picked.end());
+        return true;
+    }
+
+    void cancel() {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    void destroy() {
+        cancel();
+        glDeleteBuffers(1, &PBO);
+        PBO = 0;
+        capacity = 0;
+    }
+};
@@ -5,6 +5,8 @@
 #include <sstream>
 #include <string>
 #include <filesystem>
+#include <unordered_map>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -13,49 +15,137 @@ using ShaderProgram = unsigned int;
 struct ShaderSource {
     std::string vs; // vertex shader
     std::string fs; // fragment shader
+    std::string tcs; // tessellation control shader, optional
+    std::string tes; // tessellation evaluation shader, optional
+};
+
+// uniform locations resolved once at link time, -1 when the program does not use the uniform
+struct UniformLocations {
+    int model = -1;
+    int selected = -1;
+    int procedural = -1;
+    int big_radius = -1;
+    int small_radius = -1;
+    int theta_samples = -1;
+    int phi_samples = -1;
+    int viewport = -1;
+    int pixels_per_segment = -1;
+    int batched = -1;
+    int object_id = -1;
+    std::unordered_map<std::string, int> by_name;
+
+    [[nodiscard]]
+    int find(const std::string& name) const {
+        auto it = by_name.find(name);
+        return it == by_name.end() ? -1 : it->second;
+    }
 };
 
 struct ShaderManager {
     fs::path shaders_dir_path = {"../shaders/"};
 
+    // indexed by program name, GL hands out small consecutive integers
+    static inline std::vector<UniformLocations> uniform_cache;
+
+    [[nodiscard]]
+    static const UniformLocations& uniforms(ShaderProgram program) {
+        return uniform_cache[program];
+    }
+
+    static void cacheUniforms(ShaderProgram program) {
+        UniformLocations locations;
+
+        int count = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+
+        for (int i = 0; i < count; ++i) {
+            char name[256];
+            int length = 0;
+            int size = 0;
+            unsigned int type = 0;
+            glGetActiveUniform(program, i, sizeof(name), &length, &size, &type, name);
+
+            std::string uniform_name(name, length);
+            if (uniform_name.ends_with("[0]")) {
+                uniform_name.resize(uniform_name.size() - 3);
+            }
+
+            // members of uniform blocks have no location
+            int location = glGetUniformLocation(program, name);
+            if (location >= 0) {
+                locations.by_name[uniform_name] = location;
+            }
+        }
+
+        locations.model = locations.find("model");
+        locations.selected = locations.find("u_selected");
+        locations.procedural = locations.find("u_procedural");
+        locations.big_radius = locations.find("u_big_radius");
+        locations.small_radius = locations.find("u_small_radius");
+        locations.theta_samples = locations.find("u_theta_samples");
+        locations.phi_samples = locations.find("u_phi_samples");
+        locations.viewport = locations.find("u_viewport");
+        locations.pixels_per_segment = locations.find("u_pixels_per_segment");
+        locations.batched = locations.find("u_batched");
+        locations.object_id = locations.find("u_object_id");
+
+        if (uniform_cache.size() <= program) {
+            uniform_cache.resize(program + 1);
+        }
+        uniform_cache[program] = std::move(locations);
+    }
+
     [[nodiscard]]
     ShaderProgram shader_program(const std::string& shader_name) const {
         const auto shader_source = loadShaderSource(shader_name);
         return compileShader(shader_source);
     }
 
-    [[nodiscard]]
-    static ShaderProgram compileShader(const ShaderSource& shader_source) {
-        const char* vertexShaderCStr = shader_source.vs.c_str();
-        const char* fragmentShaderCStr = shader_source.fs.c_str();
+    static unsigned int compileStage(unsigned int type, const std::string& source, const char* stage_name) {
+        const char* sourceCStr = source.c_str();
 
-        unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderCStr, NULL);
-        glCompileShader(vertexShader);
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &sourceCStr, NULL);
+        glCompileShader(shader);
 
         int success;
         char infoLog[512];
-        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
         if (!success) {
-            glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-            std::cerr << "Vertex shader compilation failed: " << infoLog << std::endl;
+            glGetShaderInfoLog(shader, 512, NULL, infoLog);
+            std::cerr << stage_name << " shader compilation failed: " << infoLog << std::endl;
         }
 
-        unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderCStr, NULL);
-        glCompileShader(fragmentShader);
+        return shader;
+    }
 
-        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-            std::cerr << "Fragment shader compilation failed: " << infoLog << std::endl;
+    [[nodiscard]]
+    static ShaderProgram compileShader(const ShaderSource& shader_source) {
+        unsigned int vertexShader = compileStage(GL_VERTEX_SHADER, shader_source.vs, "Vertex");
+        unsigned int fragmentShader = compileStage(GL_FRAGMENT_SHADER, shader_source.fs, "Fragment");
+
+        unsigned int tessControlShader = 0;
+        unsigned int tessEvaluationShader = 0;
+        if (!shader_source.tcs.empty()) {
+            tessControlShader = compileStage(GL_TESS_CONTROL_SHADER, shader_source.tcs, "Tessellation control");
+        }
+        if (!shader_source.tes.empty()) {
+            tessEvaluationShader = compileStage(GL_TESS_EVALUATION_SHADER, shader_source.tes, "Tessellation evaluation");
         }
 
         unsigned int shaderProgram = glCreateProgram();
         glAttachShader(shaderProgram, vertexShader);
         glAttachShader(shaderProgram, fragmentShader);
+        if (tessControlShader) {
+            glAttachShader(shaderProgram, tessControlShader);
+        }
+        if (tessEvaluationShader) {
+            glAttachShader(shaderProgram, tessEvaluationShader);
+        }
         glLinkProgram(shaderProgram);
 
+        int success;
+        char infoLog[512];
         glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
         if (!success) {
             glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
@@ -64,6 +154,10 @@ struct ShaderManager {
 
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
+        glDeleteShader(tessControlShader);
+        glDeleteShader(tessEvaluationShader);
+
+        cacheUniforms(shaderProgram);
 
         return shaderProgram;
     }
@@ -73,9 +167,25 @@ struct ShaderManager {
         const auto vs = loadVertexShader(shader_name);
         const auto fs = loadFragmentShader(shader_name);
         ShaderSource shader_source = {vs, fs};
+        shader_source.tcs = loadOptionalStage(shader_name, "tcs.glsl");
+        shader_source.tes = loadOptionalStage(shader_name, "tes.glsl");
         return shader_source;
     }
 
+    [[nodiscard]]
+    std::string loadOptionalStage(const std::string& shader_name, const std::string& file_name) const {
+        auto full_path = shaders_dir_path / shader_name / file_name;
+        std::ifstream file(full_path);
+
+        if (!file.is_open()) {
+            return {};
+        }
+        std::stringstream shaderStream;
+        shaderStream << file.rdbuf();
+        file.close();
+        return shaderStream.str();
+    }
+
     [[nodiscard]]
     std::string loadVertexShader(const std::string& shader_name) const {
         auto full_path = shaders_dir_path / shader_name / "vs.glsl";
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <iostream>
+
+// Persistently mapped upload ring, split into one region per frame in flight. A region is fenced when its frame
+// has been submitted and waited on before it is written again, so CPU writes never race the GPU and the driver
+// never has to orphan or shadow the storage. Data is copied on the GPU from the ring into the destination buffer.
+struct StreamBuffer {
+    static constexpr unsigned int regionCount = 3;
+    static constexpr size_t alignment = 16;
+
+    unsigned int buffer = 0;
+    size_t region_size = 0;
+    unsigned char* mapped = nullptr;
+    std::array<GLsync, regionCount> fences{};
+    unsigned int region = 0;
+    size_t offset = 0;
+
+    void init(size_t size_per_region) {
+        region_size = size_per_region;
+
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, region_size * regionCount, nullptr, flags);
+        mapped = static_cast<unsigned char*>(glMapNamedBufferRange(buffer, 0, region_size * regionCount, flags));
+
+        if (mapped == nullptr) {
+            std::cerr << "Failed to map the stream buffer, uploads fall back to glNamedBufferSubData" << std::endl;
+        }
+    }
+
+    void begin_frame() {
+        offset = 0;
+
+        GLsync& fence = fences[region];
+        if (fence == nullptr) {
+            return;
+        }
+
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    void end_frame() {
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region = (region + 1) % regionCount;
+    }
+
+    // space for this frame's writes, nullptr once the region is exhausted; the alignment must be a power of two
+    unsigned char* allocate(size_t size, size_t& buffer_offset, size_t alignment = StreamBuffer::alignment) {
+        size_t aligned = (region * region_size + offset + alignment - 1) & ~(alignment - 1);
+        aligned -= region * region_size;
+
+        if (mapped == nullptr || aligned + size > region_size) {
+            return nullptr;
+        }
+
+        offset = aligned + size;
+        buffer_offset = region * region_size + aligned;
+        return mapped + buffer_offset;
+    }
+
+    void upload(unsigned int destination, size_t destination_offset, const void* data, size_t size) {
+        if (size == 0) {
+            return;
+        }
+
+        size_t source_offset;
+        unsigned char* staging = allocate(size, source_offset);
+
+        if (staging == nullptr) {
+            glNamedBufferSubData(destination, destination_offset, size, data);
+            return;
+        }
+
+        std::memcpy(staging, data, size);
+        glCopyNamedBufferSubData(buffer, destination, source_offset, destination_offset, size);
+    }
+
+    void destroy() {
+        for (auto& fence : fences) {
+            if (fence != nullptr) {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+
+        if (buffer != 0) {
+            glUnmapNamedBuffer(buffer);
+            glDeleteBuffers(1, &buffer);
+            buffer = 0;
+            mapped = nullptr;
+        }
+    }
+};
+
+inline StreamBuffer stream_buffer;
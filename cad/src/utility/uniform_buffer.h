@@ -0,0 +1,26 @@
+#pragma once
+
+// Uniform block shared by every program that declares it with layout (std140, binding = ...).
+// T has to follow the std140 layout of the block.
+template <typename T>
+struct UniformBuffer {
+    unsigned int UBO = 0;
+    unsigned int binding = 0;
+
+    void init(unsigned int binding_point) {
+        binding = binding_point;
+
+        glCreateBuffers(1, &UBO);
+        glNamedBufferStorage(UBO, sizeof(T), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO);
+    }
+
+    void update(const T& data) const {
+        glNamedBufferSubData(UBO, 0, sizeof(T), &data);
+    }
+
+    void destroy() {
+        glDeleteBuffers(1, &UBO);
+        UBO = 0;
+    }
+};